@@ -0,0 +1,170 @@
+#!/bin/sh
+#
+# Benchmark sweep for thread_gol, run by `make bench`.
+#
+# Times every engine over a matrix of board sizes, thread counts and
+# partition types on random soups, plus the shipped patterns at their own
+# size, and reports cells/second, speedup over one thread and parallel
+# efficiency as CSV (or JSON with FORMAT=json). Each configuration runs
+# REPEAT times and keeps its best time. The matrix is set from the
+# environment:
+#
+#   SIZES="256 1024 2048"  THREADS="1 2 4 8"  PARTITIONS="0 1 2"
+#   ENGINES="char bit hashlife sparse stream shard"
+#   PATTERNS="gosper.txt pulsar.txt grower.txt"
+#   ITERS=100  PATTERN_ITERS=2000  DENSITY=0.3  REPEAT=3
+#   FORMAT=csv  OUT=bench_output.txt  BIN=./thread_gol  STREAM_DIR=(a temp dir)
+#
+# Hashlife and the sparse engine run single-threaded and only on the
+# patterns: random soups are their worst case and say nothing about the
+# threaded engines. The stream engine keeps its board in a file in
+# STREAM_DIR, which should be on the disk it is meant to be measured on
+# rather than a tmpfs. The shard engine runs a one-thread shard per thread,
+# so threads counts its processes; it takes at least two, which its
+# one-thread row runs and its speedup is over.
+#
+
+SIZES=${SIZES:-"256 1024 2048"}
+THREADS=${THREADS:-"1 2 4 8"}
+PARTITIONS=${PARTITIONS:-"0 1 2"}
+ENGINES=${ENGINES:-"char bit hashlife sparse stream shard"}
+PATTERNS=${PATTERNS:-"gosper.txt pulsar.txt grower.txt"}
+ITERS=${ITERS:-100}
+PATTERN_ITERS=${PATTERN_ITERS:-2000}
+DENSITY=${DENSITY:-0.3}
+REPEAT=${REPEAT:-3}
+FORMAT=${FORMAT:-csv}
+OUT=${OUT:-bench_output.txt}
+BIN=${BIN:-./thread_gol}
+
+if [ "$FORMAT" != csv ] && [ "$FORMAT" != json ]; then
+  echo "Invalid FORMAT, must be either csv or json"
+  exit 1
+fi
+if [ ! -x "$BIN" ]; then
+  echo "No $BIN, run make first"
+  exit 1
+fi
+
+# Speedup needs a one-thread time for every configuration
+case " $THREADS " in
+  *" 1 "*) ;;
+  *) THREADS="1 $THREADS" ;;
+esac
+
+VERSION=$(git describe --always --dirty 2>/dev/null || echo unknown)
+WORK=$(mktemp -d)
+STREAM_DIR=${STREAM_DIR:-$WORK}
+trap 'rm -rf "$WORK" "$STREAM_DIR/bench_stream.bin"' EXIT
+RESULTS="$WORK/results"
+: > "$RESULTS"
+
+# soup SIZE: writes a SIZE x SIZE random board in the native format
+soup() {
+  awk -v n="$1" -v d="$DENSITY" -v iters="$ITERS" 'BEGIN {
+    srand(n)
+    for (x = 0; x < n; x++) {
+      for (y = 0; y < n; y++) {
+        if (rand() < d) {
+          cells[count++] = x " " y
+        }
+      }
+    }
+    print n; print n; print iters; print count
+    for (i = 0; i < count; i++) {
+      print cells[i]
+    }
+  }' > "$WORK/soup$1.txt"
+}
+
+# run INPUT ENGINE THREADS PARTITION ITERS: records the best of REPEAT runs
+# as input engine rows cols steps threads partition seconds
+run() {
+  tids=$3
+  case $2 in
+    stream) option="--stream=$STREAM_DIR/bench_stream.bin" ;;
+    shard) option="--shards=$(($3 < 2 ? 2 : $3))"; tids=1 ;;
+    *) option="" ;;
+  esac
+  best=""
+  i=0
+  while [ $i -lt "$REPEAT" ]; do
+    line=$("$BIN" "$1" 0 "$tids" "$4" 0 --engine="$2" --iters="$5" $option | grep "Elapsed time")
+    if [ -z "$line" ]; then
+      echo "Run failed: $BIN $1 0 $tids $4 0 --engine=$2 --iters=$5 $option" >&2
+      exit 1
+    fi
+    best=$(echo "$line" | awk -v best="$best" '{
+      t = $(NF-1)
+      if (best != "" && best + 0 < t + 0) {
+        t = best
+      }
+      print $4, $8, $10, t
+    }')
+    i=$((i+1))
+  done
+  echo "$best" | awk -v input="$(basename "$1")" -v engine="$2" -v threads="$3" \
+                     -v part="$4" '{
+    print input, engine, $2, $3, $1, threads, part, $4
+  }' >> "$RESULTS"
+  echo "$(basename "$1") $2 threads=$3 partition=$4: $(echo "$best" | cut -d' ' -f4)s" >&2
+}
+
+for size in $SIZES; do
+  soup "$size"
+  for engine in $ENGINES; do
+    [ "$engine" = hashlife ] || [ "$engine" = sparse ] && continue
+    for part in $PARTITIONS; do
+      for threads in $THREADS; do
+        run "$WORK/soup$size.txt" "$engine" "$threads" "$part" "$ITERS"
+      done
+    done
+  done
+done
+for pattern in $PATTERNS; do
+  for engine in $ENGINES; do
+    if [ "$engine" = hashlife ] || [ "$engine" = sparse ]; then
+      run "$pattern" "$engine" 1 0 "$PATTERN_ITERS"
+      continue
+    fi
+    for part in $PARTITIONS; do
+      for threads in $THREADS; do
+        run "$pattern" "$engine" "$threads" "$part" "$PATTERN_ITERS"
+      done
+    done
+  done
+done
+
+# Rows of one configuration share a key; its one-thread row comes first
+awk -v format="$FORMAT" -v version="$VERSION" '
+  {
+    key = $1 " " $2 " " $7
+    if ($6 == 1) {
+      base[key] = $8
+    }
+    cells = $3 * $4 * $5
+    rate = $8 > 0 ? cells / $8 : 0
+    speedup = $8 > 0 && (key in base) ? base[key] / $8 : 0
+    row = sprintf("%s,%s,%s,%d,%d,%d,%d,%d,%.6f,%.0f,%.3f,%.3f", version, $1, $2, $3, $4,
+                  $5, $6, $7, $8, rate, speedup, speedup / $6)
+    if (format == "csv") {
+      if (NR == 1) {
+        print "version,input,engine,rows,cols,steps,threads,partition,seconds," \
+              "cells_per_sec,speedup,efficiency"
+      }
+      print row
+    } else {
+      split(row, f, ",")
+      printf "%s  {\"version\": \"%s\", \"input\": \"%s\", \"engine\": \"%s\", \"rows\": %s," \
+             " \"cols\": %s, \"steps\": %s, \"threads\": %s, \"partition\": %s," \
+             " \"seconds\": %s, \"cells_per_sec\": %s, \"speedup\": %s, \"efficiency\": %s}",
+             NR == 1 ? "[\n" : ",\n", f[1], f[2], f[3], f[4], f[5], f[6], f[7], f[8], f[9],
+             f[10], f[11], f[12]
+    }
+  }
+  END {
+    if (format == "json") {
+      print NR ? "\n]" : "[]"
+    }
+  }' "$RESULTS" > "$OUT"
+echo "Wrote $OUT" >&2
@@ -8,7 +8,8 @@
 #include <sys/time.h>
 #include <string.h>
 
-// NOTES: makeBoard is malfunctioning
+// The lookup-table kernel's table has an entry for every 4x4 neighborhood
+#define TABLE_SIZE 65536
 
 char* makeBoard(int rows, int cols, FILE* file, int numCoords);
 void print(char* arr, int willPrint, int rows, int cols, int iters);
@@ -18,6 +19,9 @@ int numNeighbors(int xcoord, int ycoord, int rows, int cols, char *board,
 char *copyBoard(char *board, int rows, int cols);
 void evolve(int x, int y, int rows, int cols, char *newBoard, char *refBoard, 
     char *argv[], int numCoords, int iters);
+void makeTable(unsigned char *table);
+void evolveBlocks(int rows, int cols, char *newBoard, char *refBoard,
+                  const unsigned char *table, unsigned char *columns);
 FILE *openFile(char filename[]);
 
 char* makeBoard(int rows, int cols, FILE* file, int numCoords){
@@ -47,14 +51,18 @@ char* makeBoard(int rows, int cols, FILE* file, int numCoords){
   counter = 0;
   for(i = 0; i < rows; i++){
   	for(j = 0; j < cols; j++){
-  		array[i*rows+j]= '-';
+  		array[i*cols+j]= '-';
   	 }
   }
 
   // Read in coordinates to update board to its initial state
   while(counter < numCoords){
-    fscanf(file, "%d%d", &x,&y);
-	array[x*rows+y]='@';
+    if (fscanf(file, "%d%d", &x,&y) != 2 || x < 0 || x >= rows || y < 0 || y >= cols) {
+      printf("Invalid test parameter file, coordinate %d is missing or off the board.\n",
+             counter+1);
+      exit(1);
+    }
+	array[x*cols+y]='@';
 	counter++;
   }
   
@@ -79,19 +87,13 @@ void print(char* arr, int willPrint, int rows, int cols, int iters) {
   usleep(200000);
   system("clear");
   printf("Iteration %d:\n\n",iters); 
-  int i,k,count,partitions;
-  partitions = 4;
-
+  int i,k;
 
   for (i = 0; i < rows; i++) {
     for (k = 0; k < cols; k++) {
-      printf("%d ",count);
+      printf("%c ",arr[i*cols+k]);
     }
     printf("\n");
-    
-    if (!((i+1) % partitions)) {
-      count++;
-    }
   }
 }
 
@@ -160,9 +162,9 @@ int numNeighbors(int xCoord, int yCoord, int rows, int cols, char *board,
       }  	  
       
       // Increments neighborCounter for each neighbor found
-      if(currentRow == x && currentCol == y){
+      if(j == 0 && k == 0){
         continue;
-      }else if(board[currentRow*rows+currentCol] == '@'){
+      }else if(board[currentRow*cols+currentCol] == '@'){
          neighborCounter++;
       }
     }
@@ -218,16 +220,16 @@ void evolve(int x, int y, int rows, int cols, char *newBoard, char *refBoard,
         exit(1);
       }
       if(neighbors < 2){
-        newBoard[x*rows+y]= '-';
+        newBoard[x*cols+y]= '-';
       
       } else if(neighbors > 3){
-          newBoard[x*rows+y] = '-';
+          newBoard[x*cols+y] = '-';
 
       } else if(neighbors == 3){
-          newBoard[x*rows+y] = '@';
+          newBoard[x*cols+y] = '@';
       
       } else {
-          newBoard[x*rows+y] = refBoard[x*rows+y];
+          newBoard[x*cols+y] = refBoard[x*cols+y];
       }
         
     }
@@ -235,6 +237,87 @@ void evolve(int x, int y, int rows, int cols, char *newBoard, char *refBoard,
     print(newBoard,atoi(argv[2]),rows,cols,iters);
 }
 
+void makeTable(unsigned char *table) {
+  /*
+   * Purpose: Fills the lookup table of the block kernel. Entry i is the
+   *          next state of the 2x2 block in the middle of the 4x4
+   *          neighborhood whose cells are the bits of i, bit 4*c+r holding
+   *          the cell in row r and column c. Bit 2*r+c of the entry is
+   *          block cell (r, c)
+   * Inputs: Table of TABLE_SIZE entries: table
+   * Returns: Nothing
+   */
+  int i, r, c, dr, dc, neighbors, alive;
+  for (i = 0; i < TABLE_SIZE; i++) {
+    table[i] = 0;
+    for (r = 1; r < 3; r++) {
+      for (c = 1; c < 3; c++) {
+        neighbors = 0;
+        for (dr = -1; dr < 2; dr++) {
+          for (dc = -1; dc < 2; dc++) {
+            if (dr || dc) {
+              neighbors += (i >> (4*(c+dc) + r+dr)) & 1;
+            }
+          }
+        }
+        alive = (i >> (4*c + r)) & 1;
+        if (neighbors == 3 || (neighbors == 2 && alive)) {
+          table[i] |= 1 << (2*(r-1) + c-1);
+        }
+      }
+    }
+  }
+}
+
+void evolveBlocks(int rows, int cols, char *newBoard, char *refBoard,
+                  const unsigned char *table, unsigned char *columns) {
+  /*
+   * Purpose: Applies the rules of the Game of Life through the lookup
+   *          table, a 2x2 block at a time, giving the same board as evolve.
+   *          For each pair of rows, the four cells of every column from the
+   *          row above the pair to the row below it are packed into a
+   *          nibble once, and a block's index is four neighboring nibbles.
+   *          On a board of odd size the last blocks hang over the edge, and
+   *          only their cells on the board are kept
+   * Inputs: Rows & Columns:           rows, cols
+   *         Game boards:              newBoard, refBoard
+   *         Lookup table:             table
+   *         Room for cols+3 nibbles:  columns
+   * Returns: Nothing
+   */
+  int x, y, k, row[4];
+  unsigned char block;
+
+  for (x = 0; x < rows; x += 2) {
+    for (k = 0; k < 4; k++) {
+      row[k] = ((x-1+k) % rows + rows) % rows * cols;
+    }
+
+    // columns[y+1] holds column y, with the wrapped columns either side
+    for (y = 0; y < cols; y++) {
+      columns[y+1] = (refBoard[row[0]+y] == '@') | (refBoard[row[1]+y] == '@') << 1 |
+                     (refBoard[row[2]+y] == '@') << 2 | (refBoard[row[3]+y] == '@') << 3;
+    }
+    columns[0] = columns[cols];
+    columns[cols+1] = columns[1];
+    columns[cols+2] = columns[1 % cols + 1];
+
+    for (y = 0; y < cols; y += 2) {
+      block = table[columns[y] | columns[y+1] << 4 | columns[y+2] << 8 | columns[y+3] << 12];
+      newBoard[x*cols+y] = (block & 1) ? '@' : '-';
+      if (y+1 < cols) {
+        newBoard[x*cols+y+1] = (block & 2) ? '@' : '-';
+      }
+      if (x+1 < rows) {
+        newBoard[(x+1)*cols+y] = (block & 4) ? '@' : '-';
+        if (y+1 < cols) {
+          newBoard[(x+1)*cols+y+1] = (block & 8) ? '@' : '-';
+        }
+      }
+    }
+  }
+}
+
 FILE *openFile(char filename[]) {
   /*
    * Purpose: Bundles together a few lines for opening the test parameter
@@ -253,57 +336,92 @@ FILE *openFile(char filename[]) {
 
 int main(int argc, char *argv[]) {
   // Variable declarations
-  int count = 1;
-  int rows,cols,iters,numCoords,x,y,neighbors;
-  FILE *inFile = openFile(argv[1]);
+  int count;
+  int rows,cols,iters,numCoords,x,y;
+  FILE *inFile;
   struct timeval start, end;
   char *newBoard = NULL;
   char *refBoard = NULL;
+  char *blockBoard = NULL;
+  char *blockNext = NULL;
   char *temp;
-
-  // Threading variables
-  
+  unsigned char *table, *columns;
+  long elapsed, blockElapsed;
 
   // Process command line arguments
   verifyCmdArgs(argc, argv);
 
+  // Build the block kernel's lookup table once, up front
+  table = (unsigned char *)malloc(TABLE_SIZE);
+  if (table == NULL) {
+    printf("malloc failed");
+    exit(1);
+  }
+  makeTable(table);
+
   // Open test parameter file and read in first 4 lines
-  fscanf(inFile, "%d %d %d %d", &rows, &cols, &iters, &numCoords);
+  inFile = openFile(argv[1]);
+  if (fscanf(inFile, "%d %d %d %d", &rows, &cols, &iters, &numCoords) != 4 || rows < 1 ||
+      cols < 1 || iters < 0 || numCoords < 0) {
+    printf("Invalid test parameter file, must start with rows, cols, iterations and"
+           " number of coordinates.\n");
+    exit(1);
+  }
 
   // Create game board initialized to starting state
   newBoard = makeBoard(rows,cols,inFile,numCoords);
   refBoard = copyBoard(newBoard,rows,cols);
+  blockBoard = copyBoard(newBoard,rows,cols);
+  blockNext = copyBoard(newBoard,rows,cols);
+  columns = (unsigned char *)malloc(cols+3);
+  if (columns == NULL) {
+    printf("malloc failed");
+    exit(1);
+  }
   print(refBoard,atoi(argv[2]),rows,cols,0);
-  //printf("refBoard2: %s\n", refBoard);
-  // Apply the life and death conditions to the board
-  /*gettimeofday(&start, NULL);
-  while (count < iters+1) {
+
+  // Apply the life and death conditions to the board, a cell at a time
+  x = 0;
+  y = 0;
+  gettimeofday(&start, NULL);
+  for (count = 1; count <= iters; count++) {
     evolve(x,y,rows,cols,newBoard,refBoard,argv,numCoords,count);
 
-   
-    *temp = *refBoard;
-    *refBoard = *newBoard; // reference board updated to be the newer board
-    *newBoard = *temp;*/
-    // Very helpful visuals for showing which versions of the board
-    // are being stored in our three char *'s
-    /*printf("temBoard: %s\n", temp);  
-    printf("refBoard: %s\n", refBoard);
-    printf("newBoard: %s\n", newBoard);* s/
-    temp = copyBoard(newBoard,rows,cols); 
-    refBoard = temp; // reference board updated to be the newer board
-    //newBoard = temp;
-    ++count;
+    // The board just written becomes the reference for the next step
+    temp = refBoard;
+    refBoard = newBoard;
+    newBoard = temp;
   }
   gettimeofday(&end, NULL);
- */ 
+  elapsed = (end.tv_sec-start.tv_sec)*1000000 + (end.tv_usec - start.tv_usec);
+
+  // Then the same steps again through the lookup table
+  gettimeofday(&start, NULL);
+  for (count = 1; count <= iters; count++) {
+    evolveBlocks(rows,cols,blockNext,blockBoard,table,columns);
+    temp = blockBoard;
+    blockBoard = blockNext;
+    blockNext = temp;
+  }
+  gettimeofday(&end, NULL);
+  blockElapsed = (end.tv_sec-start.tv_sec)*1000000 + (end.tv_usec - start.tv_usec);
+
   // Time calculations
-  long elapsed = (end.tv_sec-start.tv_sec)*1000000 + (end.tv_usec - 
-                  start.tv_usec);
   printf("\nElapsed time for %d steps of a %d x %d board is: %f seconds\n",
                   iters, rows, cols, elapsed/1000000.);
+  if (memcmp(refBoard, blockBoard, (size_t)rows*cols)) {
+    printf("Lookup-table kernel: boards differ after %d steps\n", iters);
+    exit(1);
+  }
+  printf("Lookup-table kernel: %f seconds, %.1fx faster, same board\n",
+         blockElapsed/1000000., blockElapsed ? (double)elapsed/blockElapsed : 0.0);
 
   free(newBoard);
   free(refBoard);
+  free(blockBoard);
+  free(blockNext);
+  free(table);
+  free(columns);
   fclose(inFile);
   refBoard = NULL;
   newBoard = NULL;
@@ -311,4 +429,3 @@ int main(int argc, char *argv[]) {
 
   return 0;
 }
-
@@ -0,0 +1,6521 @@
+//
+// Zach Lockett-Streiff; Taylor Nation; Jacob Lewin
+// Implementation of Conway's Game of Life - Threaded Implementation
+//
+// The engines, worker pool, seed loader, checkpoints and frame ring behind
+// the simulation handle declared in golsim.h. Nothing here is global but
+// the constants: every piece of state lives in a struct golSim
+//
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <linux/mempolicy.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <ctype.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "golsim.h"
+
+// Most NUMA nodes a board's pages are spread over
+#define MAX_NODES 64
+
+// Seed file formats told apart by openSeed, and the size past which a seed's
+// cells are read by every pool thread at once
+#define SEED_NATIVE    0
+#define SEED_RLE       1
+#define SEED_LIFE106   2
+#define SEED_PLAINTEXT 3
+#define SEED_SPLIT     (1 << 20)
+
+// What reading a seed's cells does with them: list them for placeSeed, or,
+// for the packed engines, measure them first and then set them straight
+// in the mapping, so a board bigger than memory never has its cells listed
+#define SEED_LIST    0
+#define SEED_MEASURE 1
+#define SEED_PLACE   2
+
+// Hashlife nodes are carved HL_BLOCK at a time; once more than HL_GC_NODES
+// exist, each jump starts by collecting the ones its window can't reach
+#define HL_BLOCK    4096
+#define HL_GC_NODES (1 << 22)
+
+// The sparse engine's empty table slot and the flag marking a slot's cell
+// alive, and the density, live cells per cell, below which GOL_ENGINE_AUTO
+// picks it over the char engine for a board of at least SPARSE_MIN_CELLS
+#define SPARSE_EMPTY     (~(uint64_t)0)
+#define SPARSE_ALIVE     0x10
+#define SPARSE_DENSITY   (1.0/256)
+#define SPARSE_MIN_CELLS (1L << 16)
+
+// The stream engine advances its board in bands of about this many bytes.
+// Its file starts with a page holding a streamHeader with this magic
+#define STREAM_BAND_BYTES (8L*1024*1024)
+#define STREAM_MAGIC      "GOLSTRM1"
+
+// A shard exits with this status when a neighbor it trades rows with is gone.
+// Once only such shards have been reaped the parent waits up to
+// SHARD_GRACE_MS for the one that was lost before killing the rest
+#define SHARD_LOST_PEER 2
+#define SHARD_GRACE_MS  100
+
+// A rule is a pair of masks: bit n of birth is set if a dead cell with n live
+// neighbors comes alive, bit n of survive if a live one stays alive. The
+// rules with kernels of their own are numbered; any other runs RULE_TABLE's
+#define LIFE_BIRTH        (1 << 3)
+#define LIFE_SURVIVE      (1 << 2 | 1 << 3)
+#define HIGHLIFE_BIRTH    (1 << 3 | 1 << 6)
+#define HIGHLIFE_SURVIVE  (1 << 2 | 1 << 3)
+#define DAYNIGHT_BIRTH    (1 << 3 | 1 << 6 | 1 << 7 | 1 << 8)
+#define DAYNIGHT_SURVIVE  (1 << 3 | 1 << 4 | 1 << 6 | 1 << 7 | 1 << 8)
+#define SEEDS_BIRTH       (1 << 2)
+#define SEEDS_SURVIVE     0
+#define RULE_LIFE     0
+#define RULE_HIGHLIFE 1
+#define RULE_DAYNIGHT 2
+#define RULE_SEEDS    3
+#define RULE_TABLE    4
+#define NUM_RULES     5
+
+// Checkpoint files start with this magic; a snapshot is being packed by the
+// workers or written out while its state is other than CKPT_IDLE
+#define CKPT_MAGIC   "GOLCKPT1"
+#define CKPT_IDLE    0
+#define CKPT_PACKING 1
+#define CKPT_WRITING 2
+
+// Frames waiting for the frame writer
+#define FRAME_SLOTS 4
+
+// Phases a worker's time is split into when profiling, the hardware events
+// counted in each with counters on, and the most trace events kept per thread
+#define PHASE_COMPUTE 0
+#define PHASE_WAIT    1
+#define PHASE_SERIAL  2
+#define NUM_PHASES    3
+#define NUM_COUNTERS  4
+#define TRACE_EVENTS  (1 << 18)
+
+// Alignment for board buffers: a cache line, or a huge page with hugePages
+#define CACHE_LINE 64
+#define HUGE_PAGE  (2*1024*1024)
+
+// Polls of a neighbor's counter before a thread sleeps on it in the kernel,
+// when every thread has a CPU of its own to spin on
+#define SPIN_LIMIT 1000
+
+// Largest number of rows or cols a board can have. Coordinates stay ints,
+// with room left for the halo and for rounding up to whole tiles
+#define MAX_SIDE (1 << 30)
+
+// Slots the cycle history table starts with; it doubles when half full.
+// It remembers the last HISTORY_WINDOW generations, so that is the longest
+// period a cycle can have and still be found; golsim.h documents it too
+#define HISTORY_SLOTS  1024
+#define HISTORY_WINDOW (1L << 18)
+
+// Longest message golError hands back
+#define ERROR_BYTES 256
+
+// Boards carry a one-cell halo ring, so cell (x, y) exists for x in -1..rows
+// and y in -1..cols. On a torus each halo cell mirrors the opposite edge; with
+// a dead boundary it stays dead. The bit engine pads each row with a halo word
+// on either side (WORD(x, -1) and WORD(x, words)) instead of a halo column.
+// Both need the simulation, sim, in scope. The strides are size_t, so an
+// offset is computed in 64 bits and boards may pass 2^31 cells
+#define CELL(x,y) (((x)+1)*sim->stride + (y)+1)
+#define WORD(x,w) (((x)+1)*sim->wordStride + (w)+1)
+
+// A row kernel evolves cells start..end-1 of one row under the rule's masks
+typedef int (*rowKernelFn)(const char *up, const char *mid, const char *down, char *out,
+                           int start, int end, int birth, int survive);
+
+// Whether the engine runs on the worker pool over dense boards; hashlife, the
+// sparse engine and the stream and shard engines run from the calling thread
+// without them
+#define THREADED(sim) ((sim)->engine == GOL_ENGINE_CHAR || (sim)->engine == GOL_ENGINE_BIT)
+
+// Whether the engine keeps its boards in checkpoint layout, rows of words
+// with no halo, in the mapping openStream makes: the stream engine's file,
+// or the shared memory the shard engine's processes hand their bands back in
+#define PACKED(sim) ((sim)->engine == GOL_ENGINE_STREAM || (sim)->engine == GOL_ENGINE_SHARD)
+
+struct tid_args{
+  struct golSim *sim;
+  int my_tid;
+  int startRow;
+  int endRow;
+  int startCol;
+  int endCol;
+  int iter;
+  int firstTile;
+  int numTiles;
+  int cursor;
+  int tilesDone;
+  int tilesStolen;
+  int *neighbors;
+  int numNeighbors;
+  int pinCpu;
+  int cpu;
+  int node;
+  double busy;
+  double total;
+  uint64_t hashDelta[2];
+  uint64_t *streamRows;
+};
+
+// A rectangle of the board evolved as one unit. Threads own a run of tiles:
+// a single strip for partition types 0 and 1, cache-sized blocks for type 2.
+// As with tid_args, columns are words for the bit engine
+struct tile{
+  int startRow;
+  int endRow;
+  int startCol;
+  int endCol;
+};
+
+// With neighbor sync each thread's generation counter sits on a cache line
+// of its own
+struct syncCounter{
+  int done;
+  int waiters;
+  char pad[CACHE_LINE - 2*sizeof(int)];
+};
+
+// The seed file is mapped whole and its cells gathered into one list per
+// chunk, in file order, before the boards exist: the board's size may
+// depend on them. Cells are (row, column) pairs relative to the pattern,
+// which sits at (offsetX, offsetY) on the board. Every chunk keeps its
+// cells' extent; with SEED_MEASURE that and count are all it keeps, and
+// with SEED_PLACE it sets up to limit cells in the packed board, noting the
+// first one off the board in offX, offY
+struct cellList{
+  long *xs;
+  long *ys;
+  long count;
+  long cap;
+  long minX;
+  long maxX;
+  long minY;
+  long maxY;
+  long limit;
+  int offBoard;
+  long offX;
+  long offY;
+  int malformed;
+};
+struct seed{
+  char *data;
+  size_t size;
+  size_t body;
+  int format;
+  long iters;
+  long numCoords;
+  long patRows;
+  long patCols;
+  long offsetX;
+  long offsetY;
+  struct cellList *chunks;
+  int numChunks;
+  int mode;
+};
+
+// With work stealing each thread's tiles go into its own deque every
+// generation. The owner pops from the bottom, idle threads steal from the
+// top
+struct deque{
+  pthread_mutex_t lock;
+  int *items;
+  int top;
+  int bottom;
+};
+
+// Hashlife. A square of 2^k x 2^k cells is a level-k node made of four
+// level-(k-1) quadrants, down to the two level-0 cells. Nodes are hash-consed
+// so equal squares share one node, and each node memoizes its RESULT: its
+// centre 2^(k-1) square advanced 2^min(hlStep, k-2) generations. The torus is
+// run as the infinite plane tiled with copies of the board, so a window built
+// from that tiling evolves exactly like the board, and the tiling's repeats
+// keep the number of distinct nodes small however far out the window reaches
+struct node{
+  struct node *nw;
+  struct node *ne;
+  struct node *sw;
+  struct node *se;
+  struct node *result;
+  struct node *next;
+  int level;
+  int alive;
+  int mark;
+};
+
+// Window memo for hlBuild: the node of a given level whose corner is torus
+// cell (x, y)
+struct buildEntry{
+  struct node *n;
+  long x;
+  long y;
+  int level;
+};
+
+// A checkpoint file is this header followed by the board one bit per cell,
+// each row padded to whole 64-bit words like a bit engine row. The checksum
+// is FNV-1a over the bytes of those words
+struct checkpointHeader{
+  char magic[8];
+  int64_t generation;
+  int32_t rows;
+  int32_t cols;
+  uint64_t checksum;
+};
+
+// The stream file's first page: the board's size, the generation in the
+// current board, -1 while a step is rewriting the boards, and which of the
+// two boards after the page is the current one
+struct streamHeader{
+  char magic[8];
+  int64_t generation;
+  int32_t rows;
+  int32_t cols;
+  int32_t current;
+};
+
+// A board hash in the cycle history and the first generation to have it,
+// -1 for an empty slot
+struct historyEntry{
+  uint64_t hash;
+  long gen;
+};
+
+// A packed board waiting in the frame ring
+struct frame{
+  uint64_t *cells;
+  long gen;
+  int skipped;
+};
+
+// One phase of one worker, kept for the Chrome trace
+struct traceEvent{
+  double start;
+  double dur;
+  int gen;
+  int phase;
+  uint64_t counts[NUM_COUNTERS];
+};
+struct profile{
+  double mark;
+  double time[NUM_PHASES];
+  uint64_t counts[NUM_PHASES][NUM_COUNTERS];
+  uint64_t last[NUM_COUNTERS];
+  int perfFds[NUM_COUNTERS];
+  struct traceEvent *trace;
+  int numTrace;
+  int maxTrace;
+  long dropped;
+};
+
+// How the shard engine's processes pass rows. open runs in the parent
+// before the shards are forked, making the file descriptors each shard and
+// the parent keep (see shardFds) and anything else they share. After
+// generation gen of a step a shard calls exchange to send its first and
+// last rows to the shards above and below it and take its halo rows from
+// them, a NULL row meaning there is nothing across a dead edge; at the end
+// it calls gather to hand its band back. collect waits in the parent for
+// every band, and fails as soon as a shard is lost. close frees what open
+// made besides the descriptors. A transport to other hosts would fill in
+// the same calls
+struct transport{
+  const char *name;
+  int (*open)(struct golSim *sim);
+  int (*exchange)(struct golSim *sim, int gen, const uint64_t *first, const uint64_t *last,
+                  uint64_t *above, uint64_t *below);
+  int (*gather)(struct golSim *sim, const uint64_t *band, int startRow, int rows);
+  int (*collect)(struct golSim *sim);
+  void (*close)(struct golSim *sim);
+};
+
+// A transfer on one of shuttle's file descriptors, in or out
+struct transfer{
+  int fd;
+  char *buf;
+  size_t left;
+  int out;
+};
+
+struct golSim{
+  char error[ERROR_BYTES];
+  int broken;
+  int loaded;
+
+  // Each golStep starts from index 0: generation g of the step lives in
+  // boards[g%2] (bitBoards for the bit engine); step g+1 reads it and
+  // writes boards[(g+1)%2], so the two buffers simply trade roles, and the
+  // step swaps them back if it ends on index 1. generation counts every
+  // generation run since the seed or the checkpoint restored
+  char *boards[2];
+  uint64_t *bitBoards[2];
+  char *refBoard;
+  uint64_t *refBits;
+  size_t boardBytes;
+  int hugePages;
+  int rows;
+  int cols;
+  int words;
+  size_t stride;
+  size_t wordStride;
+  int deadBoundary;
+  int engine;
+  const char *simdName;
+  rowKernelFn rowKernel;
+  const char *rule;
+  int birth;
+  int survive;
+  int ruleKind;
+  struct tid_args *thread_args;
+  pthread_barrier_t barrier;
+  long generation;
+  int lastSteps;
+  int partitionType;
+
+  struct tile *tiles;
+  int totalTiles;
+  int tileRows;
+  int tileCols;
+  int tilesDown;
+  int tilesAcross;
+
+  // With activeTiles, tileChanged[g%2][t] records whether tile t differs
+  // between generations g-1 and g. A tile whose 3x3 block of tiles all held
+  // still cannot change either, so the step skips it: both boards already
+  // hold its cells. skippedTiles[z%2] counts the skips of step z until the
+  // barrier's serial thread folds it into totalSkipped
+  unsigned char *tileChanged[2];
+  int activeTiles;
+  int skippedTiles[2];
+  long totalSkipped;
+
+  // With haloDepth k each tile is copied with k extra cells on every side
+  // into a thread's private buffers and run k generations there, the copy's
+  // border shrinking by a cell per generation, so the threads meet at the
+  // barrier once every k generations. Superstep s reads boards[s%2] and
+  // writes boards[(s+1)%2]
+  int haloDepth;
+
+  // With syncNeighbors there is no barrier: each thread publishes how many
+  // generations it has finished in its own counter, and starts step z once
+  // every thread owning a tile next to one of its own has finished z. A
+  // neighbor that far along has also stopped reading the buffer step z
+  // overwrites. Waiters spin briefly, then sleep on the counter with a futex
+  struct syncCounter *counters;
+  int syncNeighbors;
+  int spinLimit;
+
+  // The workers form a pool: they are created once and then handed jobs, each
+  // job running on every worker with that worker's tid_args. Clearing the
+  // boards is a job of its own, so that with NUMA placement each page is
+  // first touched by the thread that will evolve it
+  pthread_t *poolTids;
+  int poolSize;
+  pthread_mutex_t poolLock;
+  pthread_cond_t poolWake;
+  pthread_cond_t poolIdle;
+  void *(*poolJob)(void *);
+  int poolJobId;
+  int poolRunning;
+  int poolQuit;
+  int pinThreads;
+  int numaMode;
+
+  struct seed seed;
+  int sizeRows;
+  int sizeCols;
+
+  // Generation z draws from deques[z%2] while finished threads already
+  // refill deques[(z+1)%2], which nobody touches until the barrier
+  struct deque *deques[2];
+  int workStealing;
+  int threadCount;
+
+  // With checkpointEvery n, generation g is saved when g is a multiple of n.
+  // The workers pack generation g into ckptData at the start of step g, while
+  // its buffer is only being read, and the serial thread of the following
+  // barrier hands the snapshot to the writer thread. ckptDue[g%2] says whether
+  // g is saved; it is settled two barriers ahead so every worker sees it, and a
+  // checkpoint falling due while the last one is still being packed or written
+  // is skipped. Within a golStep generations count from genBase. A snapshot
+  // the writer fails to save is counted in ckptFailed, and the reason is kept
+  // in ckptError for golFlush to hand to golError
+  const char *ckptFile;
+  int ckptEvery;
+  long genBase;
+  int ckptLast;
+  uint64_t *ckptData;
+  char ckptDue[2];
+  int ckptGen;
+  int ckptState;
+  long ckptWritten;
+  long ckptSkipped;
+  long ckptFailed;
+  char ckptError[ERROR_BYTES];
+  int ckptQuit;
+  int ckptStarted;
+  pthread_t ckptThread;
+  pthread_mutex_t ckptLock;
+  pthread_cond_t ckptWake;
+  pthread_cond_t ckptIdle;
+
+  // Frames go through a ring of FRAME_SLOTS packed boards to a writer thread
+  // that hands them to frameFn. Like checkpoints, frame g is packed by the
+  // workers at the start of the step that reads generation g (superstep,
+  // with haloDepth) and committed at the following barrier. frameDue[s%2]
+  // holds the slot reserved for step s, or -1. Slots are reserved two
+  // barriers ahead, in generation order: when the ring is full a frame is
+  // dropped, unless frameWait asks for the workers to wait for a free slot
+  golFrameFn frameFn;
+  void *frameArg;
+  int frameWait;
+  struct frame frames[FRAME_SLOTS];
+  int frameDue[2];
+  long frameHead;
+  long frameCommitted;
+  long frameTail;
+  int frameQuit;
+  int frameEvery;
+  int frameSteps;
+  int framesStarted;
+  long framesShown;
+  long framesDropped;
+  pthread_t frameThread;
+  pthread_mutex_t frameLock;
+  pthread_cond_t frameWake;
+  pthread_cond_t frameFree;
+
+  // When profiling each worker splits every generation into computing its
+  // tiles, waiting at the barrier (or on its neighbors) and, on the barrier's
+  // serial thread, finishing the generation. endPhase charges the time since
+  // the last phase ended, and with hwCounters the hardware events too, to the
+  // phase just over, and keeps the phase as an event of a Chrome trace. With
+  // profiling off, each hook is one untaken branch. The load balance
+  // report's busy time is kept when profiling or asked for by loadBalance,
+  // and otherwise the clock isn't read around each tile
+  struct profile *profiles;
+  int profiling;
+  int timeTiles;
+  int trace;
+  int hwCounters;
+  int countersWarned;
+  double traceBase;
+
+  struct node **hlTable;
+  size_t hlTableSize;
+  size_t hlNodes;
+  struct node *hlFreeList;
+  struct node **hlBlocks;
+  int hlNumBlocks;
+  int hlStep;
+  int hlCollections;
+  size_t hlLastNodes;
+  struct buildEntry *hlMemo;
+  size_t hlMemoSize;
+  size_t hlMemoUsed;
+
+  // The sparse engine keeps only the live cells, each as the key x<<32 | y.
+  // A generation counts, in an open-addressed table keyed the same way, how
+  // many live neighbors each cell next to a live one has, with SPARSE_ALIVE
+  // set on the live cells themselves, and the table's births and survivors
+  // become the next list. The list is in row-major order while liveSorted
+  // is set. autoEngine says the engine was picked by GOL_ENGINE_AUTO
+  uint64_t *live;
+  long numLive;
+  long liveCap;
+  long livePeak;
+  int liveSorted;
+  uint64_t *sparseKeys;
+  unsigned char *sparseCounts;
+  size_t sparseSize;
+  int autoEngine;
+
+  // The stream engine keeps both generations in streamFile, mapped at
+  // streamMap after a header page of streamHead bytes, each in checkpoint
+  // layout and starting on a page boundary streamHalf bytes after the
+  // other; bitBoards point at them. With streamResume an existing file is
+  // carried on from, and streamResumed says one was. A
+  // generation is computed a band of streamBand rows at a time, the
+  // workers splitting the band's rows between them, each with three
+  // padded rows of its own in streamRows. Ahead of each band the kernel is
+  // asked to read the next one in, and behind it the bands done with are
+  // dropped from the mapping, so only about three bands of the file are
+  // resident
+  const char *streamFile;
+  int streamResume;
+  int streamResumed;
+  int streamFd;
+  uint64_t *streamMap;
+  size_t streamHead;
+  size_t streamHalf;
+  int streamBand;
+  int streamStart;
+  int streamEnd;
+
+  // The shard engine forks a shard per band of rows for each golStep. A
+  // shard copies its band, with a halo row above and below, out of the
+  // current board, which the stream engine's code keeps in shared memory,
+  // and runs the stream engine's band kernel on a pool of its own, trading
+  // edge rows with its neighbors through the transport after every
+  // generation. At the end it hands its band back to the parent, into
+  // shardOut, the spare board, and the step swaps the boards once every
+  // band is in. A shard that dies fails the step and the board stays at
+  // the generation it started from; lostShard is the one to blame, the
+  // one with the highest lostRank. shardFds holds four descriptors per
+  // shard s: at 4s and 4s+1 the parent's and the shard's ends of its line
+  // to the parent, at 4s+2 and 4s+3 shard s's and shard s+1's ends of the
+  // line between them, -1 where a transport has no use for one. Each
+  // process closes the descriptors that aren't its own, so a lost shard's
+  // peers see its lines close. The shm transport passes rows through
+  // mailboxes in shardMail, two per shard for each generation parity,
+  // posting each generation in the shard's shardCounters entry; a shard
+  // writes a mailbox again only two generations on, once both neighbors
+  // have posted the generation after the one they read it for
+  const struct transport *transport;
+  int shards;
+  int shard;
+  pid_t *shardPids;
+  int *shardFds;
+  int shardUp;
+  int shardDown;
+  int shardParent;
+  uint64_t *shardOut;
+  int lostShard;
+  int lostRank;
+  int lostStatus;
+  void *shardShm;
+  size_t shardShmBytes;
+  struct syncCounter *shardCounters;
+  uint64_t *shardMail;
+
+  // With cycles every generation's board is hashed Zobrist-style, as the
+  // XOR of splitmix64 of each live cell's key, x<<32 | y, so the board's
+  // hash is the XOR of its tiles' hashes in tileHash. A worker that changes
+  // a tile rehashes it and folds the old and new hashes into its
+  // hashDelta[z%2]; the barrier's serial thread folds those into boardHash
+  // and looks the generation up in history, which maps each hash seen in
+  // the last HISTORY_WINDOW generations to the first generation that had
+  // it. historyRing holds those hashes oldest first from historyOldest, so
+  // the oldest can be dropped once the window is full. A repeat sets
+  // stopAt, and as with checkpoints the workers see it a barrier later, so
+  // they run one generation more, which runThreaded drops. A repeated hash
+  // only suggests a cycle; cycleConfirmed is set once a period has been
+  // run and came back to the same board, which skipping waits for. hashing
+  // is fixed for the length of a run
+  int cycles;
+  int hashing;
+  uint64_t *tileHash;
+  uint64_t boardHash;
+  struct historyEntry *history;
+  uint64_t *historyRing;
+  size_t historySize;
+  size_t historyUsed;
+  size_t historyOldest;
+  long cycleStart;
+  long cyclePeriod;
+  long cycleSkipped;
+  int cycleConfirmed;
+  int stopAt;
+};
+
+static const char *phaseNames[NUM_PHASES] = {"compute", "wait", "serial"};
+static const char *counterNames[NUM_COUNTERS] = {"cycles", "instructions", "llc_misses",
+                                                 "branch_misses"};
+
+// The two level-0 nodes, shared by every simulation: hashlife never writes
+// to them
+static struct node hlDead = {0};
+static struct node hlAlive = {0, 0, 0, 0, 0, 0, 0, 1, 0};
+
+static int golFail(struct golSim *sim, const char *format, ...);
+static int whyFailed(char *why, const char *format, ...);
+static void formatError(char *why, const char *format, va_list args);
+static int isAlive(struct golSim *sim, int x, int y);
+static void *allocBoard(struct golSim *sim, size_t bytes);
+static void freeBoard(struct golSim *sim, void *board);
+static void allocBoards(struct golSim *sim);
+static int onlineNodes(unsigned long *mask);
+static void placeBoard(struct golSim *sim, void *board);
+static void clearRegion(struct golSim *sim, int startRow, int endRow, int startCol, int endCol);
+static void *touchPartition(void *args);
+static void refreshHalo(struct golSim *sim, char *board, int startRow, int endRow, int startCol,
+                        int endCol);
+static int parseRule(const char *rule, int *birth, int *survive);
+static int ruleKind(int birth, int survive);
+static int selectKernel(struct golSim *sim);
+static int evolveTile(struct golSim *sim, const char *ref, char *out, struct tile *t);
+static void *evolve(void *args);
+static int tileActive(struct golSim *sim, int t, int iter);
+static void makeTileChanged(struct golSim *sim);
+static void *evolveBlocked(void *args);
+static void loadBlock(struct golSim *sim, char *buf, const char *board, struct tile *t, int depth);
+static void evolveBlock(struct golSim *sim, char *bufs[2], char *out, struct tile *t, int depth,
+                        int steps);
+static void makeNeighbors(struct golSim *sim, struct tid_args *thread_args, int numTids);
+static void freeNeighbors(struct golSim *sim, struct tid_args *thread_args, int numTids);
+static void waitNeighbors(struct golSim *sim, struct tid_args *my_args, int gen);
+static void publishGeneration(struct golSim *sim, struct tid_args *my_args, int gen);
+static void waitCounter(struct golSim *sim, struct syncCounter *c, int gen, int op);
+static void postCounter(struct syncCounter *c, int gen, int op);
+static void poolStart(struct golSim *sim, struct tid_args *thread_args, int numTids);
+static void *poolWorker(void *args);
+static void poolRun(struct golSim *sim, void *(*job)(void *));
+static void poolStop(struct golSim *sim);
+static void printPlacement(struct golSim *sim, struct tid_args *thread_args, int numTids);
+static double now(void);
+static void makeDeques(struct golSim *sim, struct tid_args *thread_args, int numTids);
+static void freeDeques(struct golSim *sim, int numTids);
+static void fillDeque(struct deque *dq, struct tid_args *my_args);
+static int nextTile(struct golSim *sim, struct tid_args *my_args, int iter);
+static void printLoadBalance(struct golSim *sim, struct tid_args *thread_args, int numTids);
+static void makeProfiles(struct golSim *sim, int numTids, int steps);
+static void openCounters(struct golSim *sim, struct profile *p);
+static void readCounters(struct profile *p, uint64_t *values);
+static void startProfile(struct golSim *sim, struct tid_args *my_args);
+static void endPhase(struct golSim *sim, struct tid_args *my_args, int phase, int gen);
+static void stopProfile(struct golSim *sim, struct tid_args *my_args);
+static void printProfile(struct golSim *sim, int numTids);
+static int writeTrace(struct golSim *sim, const char *filename, int numTids);
+static void freeProfiles(struct golSim *sim, int numTids);
+static void refreshBitHalo(struct golSim *sim, uint64_t *board, int startRow, int endRow,
+                           int startW, int endW);
+static int evolveBitTile(struct golSim *sim, const uint64_t *ref, uint64_t *out, struct tile *t);
+static void finishGeneration(struct golSim *sim, int iter);
+static void hlInit(struct golSim *sim);
+static void hlFree(struct golSim *sim);
+static struct node *hlAlloc(struct golSim *sim);
+static void hlGrow(struct golSim *sim);
+static struct node *hlJoin(struct golSim *sim, struct node *nw, struct node *ne, struct node *sw,
+                           struct node *se);
+static void hlSetStep(struct golSim *sim, int step);
+static void hlMark(struct node *n);
+static void hlCollect(struct golSim *sim, struct node *root);
+static struct node *hlLeafResult(struct golSim *sim, struct node *n);
+static struct node *hlResult(struct golSim *sim, struct node *n);
+static struct buildEntry *hlMemoSlot(struct golSim *sim, int level, long x, long y);
+static struct node *hlBuild(struct golSim *sim, int level, long x, long y);
+static void hlExtract(struct golSim *sim, struct node *n, long x, long y, long shift);
+static void runHashlife(struct golSim *sim, int iters);
+static void addLive(struct golSim *sim, uint64_t key);
+static int compareKeys(const void *a, const void *b);
+static void sortLive(struct golSim *sim);
+static void sparseStep(struct golSim *sim);
+static int runSparse(struct golSim *sim, int iters);
+static void packLive(struct golSim *sim, uint64_t *dst, int startRow, int endRow);
+static int openStream(struct golSim *sim);
+static void markStream(struct golSim *sim, long gen);
+static void adviseRows(struct golSim *sim, uint64_t *board, int startRow, int endRow,
+                       int advice);
+static void loadStreamRow(struct golSim *sim, uint64_t *dst, const uint64_t *board, int x);
+static void *streamBand(void *args);
+static void runStream(struct golSim *sim, int iters);
+static int bandStart(struct golSim *sim, int shard);
+static int shuttle(struct transfer *t, int n, struct pollfd *fds, int *failed);
+static int shmOpen(struct golSim *sim);
+static int shmExchange(struct golSim *sim, int gen, const uint64_t *first, const uint64_t *last,
+                       uint64_t *above, uint64_t *below);
+static int shmGather(struct golSim *sim, const uint64_t *band, int startRow, int rows);
+static int shmCollect(struct golSim *sim);
+static void shmClose(struct golSim *sim);
+static int socketOpen(struct golSim *sim);
+static int socketExchange(struct golSim *sim, int gen, const uint64_t *first,
+                          const uint64_t *last, uint64_t *above, uint64_t *below);
+static int socketGather(struct golSim *sim, const uint64_t *band, int startRow, int rows);
+static int socketCollect(struct golSim *sim);
+static void keepShardFds(struct golSim *sim, int shard);
+static void closeShardFds(struct golSim *sim);
+static void reapShard(struct golSim *sim, int shard, int killed, int options);
+static void runShard(struct golSim *sim, int steps);
+static int runShards(struct golSim *sim, int steps);
+static int chooseEngine(struct golSim *sim);
+static uint64_t hashTile(struct golSim *sim, const char *board, const uint64_t *bits,
+                         struct tile *t);
+static void *hashTiles(void *args);
+static uint64_t hashLive(struct golSim *sim);
+static void growHistory(struct golSim *sim);
+static size_t findHistory(struct golSim *sim, uint64_t hash);
+static void dropOldestHistory(struct golSim *sim);
+static int noteGeneration(struct golSim *sim, long gen, uint64_t hash);
+static void resetHistory(struct golSim *sim);
+static void planSteps(struct golSim *sim, int steps);
+static int runThreaded(struct golSim *sim, int steps);
+static int runEngine(struct golSim *sim, int steps);
+static int skipCycle(struct golSim *sim, int steps);
+static int openSeed(struct golSim *sim, const char *filename);
+static const char *nextLine(const char *p, const char *end);
+static const char *parseInt(const char *p, const char *end, long *value);
+static void addCell(struct golSim *sim, struct cellList *list, long x, long y);
+static void *parseChunk(void *args);
+static void parseTokens(struct golSim *sim, struct cellList *list);
+static void parseRLE(struct golSim *sim, struct cellList *list);
+static void parsePlaintext(struct golSim *sim, struct cellList *list);
+static int finishSeed(struct golSim *sim);
+static int placeSeed(struct golSim *sim);
+static int placePacked(struct golSim *sim);
+static void freeSeed(struct golSim *sim);
+static void partition(struct golSim *sim, struct tid_args *thread_args, int numTids,
+                      int partitionType);
+static long cacheSize(int level);
+static void tilePartition(struct golSim *sim, struct tid_args *thread_args, int numTids);
+static void printPartitions(struct tid_args *thread_args, int tid, int willPrint);
+static void printTiles(struct golSim *sim, struct tid_args *thread_args, int tid);
+static uint64_t fnv1a(const void *data, size_t bytes);
+static void packRow(struct golSim *sim, uint64_t *row, const char *board, const uint64_t *bits,
+                    int x);
+static void packRows(struct golSim *sim, uint64_t *dst, const char *board, const uint64_t *bits,
+                     int startRow, int endRow);
+static int writeCheckpoint(struct golSim *sim, const char *filename, const uint64_t *data,
+                           long gen, char *why);
+static int planCheckpoint(struct golSim *sim, int gen);
+static void handCheckpoint(struct golSim *sim, int gen);
+static void *checkpointWriter(void *args);
+static void startCheckpoints(struct golSim *sim);
+static void waitCheckpoint(struct golSim *sim);
+static void stopCheckpoints(struct golSim *sim);
+static int planFrame(struct golSim *sim, int step);
+static void commitFrame(struct golSim *sim);
+static void pushFrame(struct golSim *sim, long gen);
+static void *frameWriter(void *args);
+static void startFrames(struct golSim *sim);
+static void waitFrames(struct golSim *sim);
+static void stopFrames(struct golSim *sim);
+static int checkLoaded(struct golSim *sim);
+static int loadFailed(struct golSim *sim);
+static const struct transport *findTransport(const char *name);
+static const char *checkOptions(const struct golOptions *opts);
+
+// The shard engine's transports, looked up by name
+#define NUM_TRANSPORTS 2
+static const struct transport transports[NUM_TRANSPORTS] = {
+  {"shm", shmOpen, shmExchange, shmGather, shmCollect, shmClose},
+  {"socket", socketOpen, socketExchange, socketGather, socketCollect, NULL},
+};
+
+static int golFail(struct golSim *sim, const char *format, ...) {
+  /*
+   * Purpose: Records why a call failed, for golError
+   * Inputs: printf-style message: format, ...
+   * Returns: -1, for the caller to return
+   */
+  va_list args;
+  va_start(args, format);
+  formatError(sim->error, format, args);
+  va_end(args);
+  return -1;
+}
+
+static int whyFailed(char *why, const char *format, ...) {
+  /*
+   * Purpose: Records why something failed in a buffer of its own, for a
+   *          caller that reports the failure later or elsewhere
+   * Inputs: Room for the message:  why (ERROR_BYTES)
+   *         printf-style message:  format, ...
+   * Returns: 0, for the caller to return
+   */
+  va_list args;
+  va_start(args, format);
+  formatError(why, format, args);
+  va_end(args);
+  return 0;
+}
+
+static void formatError(char *why, const char *format, va_list args) {
+  /*
+   * Purpose: Formats a failure message into ERROR_BYTES. One too long for
+   *          that, as with long file names, ends in "..." so the cut shows
+   * Inputs: Room for the message:  why (ERROR_BYTES)
+   *         printf-style message:  format, args
+   * Returns: Nothing
+   */
+  if (vsnprintf(why, ERROR_BYTES, format, args) >= ERROR_BYTES) {
+    memcpy(why + ERROR_BYTES - 4, "...", 4);
+  }
+}
+
+static int isAlive(struct golSim *sim, int x, int y) {
+  /*
+   * Purpose: Reads one cell of the reference board, whichever engine owns it
+   * Inputs: Coordinates: x, y
+   * Returns: 1 if the cell is alive, 0 otherwise
+   */
+  uint64_t key = (uint64_t)x << 32 | (uint64_t)y;
+  if (sim->engine == GOL_ENGINE_SPARSE) {
+    sortLive(sim);
+    return bsearch(&key, sim->live, sim->numLive, sizeof(uint64_t), compareKeys) != NULL;
+  }
+  if (sim->engine == GOL_ENGINE_BIT) {
+    return (sim->refBits[WORD(x,y/64)] >> (y%64)) & 1;
+  }
+  if (PACKED(sim)) {
+    return (sim->refBits[(size_t)x*sim->words + y/64] >> (y%64)) & 1;
+  }
+  return sim->refBoard[CELL(x,y)] == '@';
+}
+
+static void *allocBoard(struct golSim *sim, size_t bytes) {
+  /*
+   * Purpose: Allocates a board buffer aligned to a cache line. With
+   *          hugePages the buffer is mapped from explicit huge pages when
+   *          the system has them reserved, else from a 2MB-aligned mapping
+   *          marked for transparent huge pages
+   * Inputs: Size in bytes: bytes
+   * Returns: The buffer
+   */
+  void *board = NULL;
+  if (sim->hugePages) {
+    size_t mapped = (bytes + HUGE_PAGE-1) & ~(size_t)(HUGE_PAGE-1);
+    char *raw, *aligned;
+#ifdef MAP_HUGETLB
+    board = mmap(NULL, mapped, PROT_READ|PROT_WRITE,
+                 MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+    if (board != MAP_FAILED) {
+      return board;
+    }
+#endif
+    // Over-map by one huge page and trim both ends to the alignment
+    raw = (char *)mmap(NULL, mapped + HUGE_PAGE, PROT_READ|PROT_WRITE,
+                       MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+      printf("mmap failed");
+      exit(1);
+    }
+    aligned = (char *)(((uintptr_t)raw + HUGE_PAGE-1) & ~(uintptr_t)(HUGE_PAGE-1));
+    if (aligned > raw) {
+      munmap(raw, aligned - raw);
+    }
+    munmap(aligned + mapped, raw + HUGE_PAGE - aligned);
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, mapped, MADV_HUGEPAGE);
+#endif
+    return aligned;
+  }
+  if (posix_memalign(&board, CACHE_LINE, bytes)) {
+    printf("malloc failed");
+    exit(1);
+  }
+  return board;
+}
+
+static void freeBoard(struct golSim *sim, void *board) {
+  /*
+   * Purpose: Releases a buffer from allocBoard
+   * Inputs: Board: board
+   * Returns: Nothing
+   */
+  if (board == NULL) {
+    return;
+  }
+  if (sim->hugePages) {
+    munmap(board, (sim->boardBytes + HUGE_PAGE-1) & ~(size_t)(HUGE_PAGE-1));
+  } else {
+    free(board);
+  }
+}
+
+static void allocBoards(struct golSim *sim) {
+  /*
+   * Purpose: Allocates the engine's board buffers, two of them or one for
+   *          hashlife, and applies the NUMA policy. Nothing is written to
+   *          them yet, so no page has been placed
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  int p;
+  for (p = 0; p < (sim->engine == GOL_ENGINE_HASHLIFE ? 1 : 2); p++) {
+    if (sim->engine == GOL_ENGINE_BIT) {
+      sim->bitBoards[p] = (uint64_t *)allocBoard(sim, sim->boardBytes);
+      placeBoard(sim, sim->bitBoards[p]);
+    } else {
+      sim->boards[p] = (char *)allocBoard(sim, sim->boardBytes);
+      placeBoard(sim, sim->boards[p]);
+    }
+  }
+}
+
+static int onlineNodes(unsigned long *mask) {
+  /*
+   * Purpose: Sets a bit in mask for each online NUMA node, reading a list
+   *          like "0-1,3" from sysfs; a system without that file counts as
+   *          the single node 0
+   * Inputs: Node mask, MAX_NODES bits: mask
+   * Returns: Number of nodes found
+   */
+  FILE *file = fopen("/sys/devices/system/node/online", "r");
+  int first, last, node, count = 0;
+  char sep;
+  if (file == NULL) {
+    mask[0] |= 1;
+    return 1;
+  }
+  while (fscanf(file, "%d", &first) == 1) {
+    last = first;
+    if (fscanf(file, "%c", &sep) == 1 && sep == '-') {
+      fscanf(file, "%d", &last);
+      fscanf(file, "%c", &sep);
+    }
+    for (node = first; node <= last && node < MAX_NODES; node++) {
+      mask[node/64] |= 1UL << (node%64);
+      count++;
+    }
+  }
+  fclose(file);
+  return count;
+}
+
+static void placeBoard(struct golSim *sim, void *board) {
+  /*
+   * Purpose: Sets the NUMA policy for a board's pages before they are
+   *          touched: spread round-robin over every node for interleave, or
+   *          bound to the main thread's node for local. First-touch needs no
+   *          policy, only the right thread doing the touching
+   * Inputs: Board: board
+   * Returns: Nothing
+   */
+  unsigned long mask[(MAX_NODES+63)/64] = {0};
+  long page = sysconf(_SC_PAGESIZE);
+  uintptr_t start = (uintptr_t)board & ~(uintptr_t)(page-1);
+  unsigned cpu, node;
+  int mode;
+
+  if (sim->numaMode == GOL_NUMA_INTERLEAVE) {
+    mode = MPOL_INTERLEAVE;
+    onlineNodes(mask);
+  } else if (sim->numaMode == GOL_NUMA_LOCAL) {
+    mode = MPOL_BIND;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL)) {
+      node = 0;
+    }
+    mask[node/64] |= 1UL << (node%64);
+  } else {
+    return;
+  }
+  if (syscall(SYS_mbind, start, (uintptr_t)board + sim->boardBytes - start, mode, mask,
+              (unsigned long)MAX_NODES+1, 0)) {
+    printf("mbind failed, leaving board placement to the kernel\n");
+  }
+}
+
+static void clearRegion(struct golSim *sim, int startRow, int endRow, int startCol, int endCol) {
+  /*
+   * Purpose: Kills every cell of a region in both boards, along with the
+   *          halo cells beside it at the board's edges
+   * Inputs: Region: startRow..endRow, startCol..endCol (words for the bit
+   *                 engine)
+   * Returns: Nothing
+   */
+  int width = (sim->engine == GOL_ENGINE_BIT) ? sim->words : sim->cols;
+  int x, p;
+  if (startRow == 0) {
+    startRow = -1;
+  }
+  if (endRow == sim->rows-1) {
+    endRow = sim->rows;
+  }
+  if (startCol == 0) {
+    startCol = -1;
+  }
+  if (endCol == width-1) {
+    endCol = width;
+  }
+  for (p = 0; p < 2; p++) {
+    for (x = startRow; x <= endRow; x++) {
+      if (sim->engine == GOL_ENGINE_BIT) {
+        memset(sim->bitBoards[p] + WORD(x,startCol), 0, (endCol-startCol+1)*sizeof(uint64_t));
+      } else if (sim->boards[p]) {
+        memset(sim->boards[p] + CELL(x,startCol), '-', endCol-startCol+1);
+      }
+    }
+  }
+}
+
+static void *touchPartition(void *args) {
+  /*
+   * Purpose: Pool job clearing the boards under a thread's own tiles, so
+   *          under first-touch placement their pages land on its node
+   * Inputs: Argument struct: *args
+   * Returns: Nothing
+   */
+  struct tid_args *my_args = (struct tid_args *)args;
+  struct golSim *sim = my_args->sim;
+  int t;
+  for (t = my_args->firstTile; t < my_args->firstTile+my_args->numTiles; t++) {
+    clearRegion(sim, sim->tiles[t].startRow, sim->tiles[t].endRow, sim->tiles[t].startCol,
+                sim->tiles[t].endCol);
+  }
+  return NULL;
+}
+
+static void refreshHalo(struct golSim *sim, char *board, int startRow, int endRow, int startCol,
+                        int endCol) {
+  /*
+   * Purpose: Mirrors the edge cells of a freshly computed region into the
+   *          halo on the opposite side of the board. Each thread refreshes
+   *          only the halo cells its own region feeds, before the barrier,
+   *          so the halo is complete when the next generation reads it
+   * Inputs: Board:        board
+   *         Region:       startRow..endRow, startCol..endCol
+   * Returns: Nothing
+   */
+  int x, width;
+  if (sim->deadBoundary) {
+    return;
+  }
+  width = endCol-startCol+1;
+  if (startRow == 0) {
+    memcpy(board + CELL(sim->rows,startCol), board + CELL(0,startCol), width);
+  }
+  if (endRow == sim->rows-1) {
+    memcpy(board + CELL(-1,startCol), board + CELL(sim->rows-1,startCol), width);
+  }
+  if (startCol == 0) {
+    for (x = startRow; x <= endRow; x++) {
+      board[CELL(x,sim->cols)] = board[CELL(x,0)];
+    }
+    if (startRow == 0) {
+      board[CELL(sim->rows,sim->cols)] = board[CELL(0,0)];
+    }
+    if (endRow == sim->rows-1) {
+      board[CELL(-1,sim->cols)] = board[CELL(sim->rows-1,0)];
+    }
+  }
+  if (endCol == sim->cols-1) {
+    for (x = startRow; x <= endRow; x++) {
+      board[CELL(x,-1)] = board[CELL(x,sim->cols-1)];
+    }
+    if (startRow == 0) {
+      board[CELL(sim->rows,-1)] = board[CELL(0,sim->cols-1)];
+    }
+    if (endRow == sim->rows-1) {
+      board[CELL(-1,-1)] = board[CELL(sim->rows-1,sim->cols-1)];
+    }
+  }
+}
+
+static inline __attribute__((always_inline))
+int ruleRowScalar(const char *up, const char *mid, const char *down, char *out, int start,
+                  int end, int birth, int survive) {
+  /*
+   * Purpose: Evolves cells start..end-1 of one row; the halo supplies the
+   *          neighbors past either end. Inlined with constant masks, the
+   *          rule's lookup folds into its own compares
+   * Inputs: Rows above, at and below the cells: up, mid, down
+   *         Output row:                         out
+   *         Column range:                       start, end
+   *         Rule masks:                         birth, survive
+   * Returns: Nonzero if any of the cells changed
+   */
+  int y, changed = 0;
+  for (y = start; y < end; y++) {
+    int neighbors = (up[y-1] == '@') + (up[y] == '@') + (up[y+1] == '@') +
+                    (mid[y-1] == '@') + (mid[y+1] == '@') +
+                    (down[y-1] == '@') + (down[y] == '@') + (down[y+1] == '@');
+    if (birth == LIFE_BIRTH && survive == LIFE_SURVIVE) {
+      out[y] = (neighbors == 3 || (neighbors == 2 && mid[y] == '@')) ? '@' : '-';
+    } else {
+      out[y] = ((((mid[y] == '@') ? survive : birth) >> neighbors) & 1) ? '@' : '-';
+    }
+    changed |= out[y] != mid[y];
+  }
+  return changed;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Each lane's neighbor count is built by adding the 0/-1 compare results of
+// the eight neighbor loads, so a count of n shows up as -n. Lanes whose next
+// state differs from the current one are ORed into diff for the return value.
+// Conway's rule is two compares; any other tests each count its masks name,
+// an unrolled loop the constant masks of a named rule prune to its compares.
+// These run whole vectors from *start and leave *start at the tail they
+// could not fill
+
+static inline __attribute__((always_inline, target("sse2")))
+int ruleRowSSE2(const char *up, const char *mid, const char *down, char *out, int *start,
+                int end, int birth, int survive) {
+  // 16 cells per step
+  const __m128i at = _mm_set1_epi8('@'), dash = _mm_set1_epi8('-');
+  const __m128i two = _mm_set1_epi8(-2), three = _mm_set1_epi8(-3);
+  __m128i diff = _mm_setzero_si128();
+  int y, n;
+#define NEIGHBOR128(p) _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p)), at)
+  for (y = *start; y + 16 <= end; y += 16) {
+    __m128i cnt = NEIGHBOR128(up+y-1);
+    cnt = _mm_add_epi8(cnt, NEIGHBOR128(up+y));
+    cnt = _mm_add_epi8(cnt, NEIGHBOR128(up+y+1));
+    cnt = _mm_add_epi8(cnt, NEIGHBOR128(mid+y-1));
+    cnt = _mm_add_epi8(cnt, NEIGHBOR128(mid+y+1));
+    cnt = _mm_add_epi8(cnt, NEIGHBOR128(down+y-1));
+    cnt = _mm_add_epi8(cnt, NEIGHBOR128(down+y));
+    cnt = _mm_add_epi8(cnt, NEIGHBOR128(down+y+1));
+    __m128i alive = NEIGHBOR128(mid+y);
+    __m128i live = _mm_setzero_si128();
+    if (birth == LIFE_BIRTH && survive == LIFE_SURVIVE) {
+      live = _mm_or_si128(_mm_cmpeq_epi8(cnt, three),
+                          _mm_and_si128(_mm_cmpeq_epi8(cnt, two), alive));
+    } else {
+#pragma GCC unroll 9
+      for (n = 0; n <= 8; n++) {
+        __m128i eq = _mm_cmpeq_epi8(cnt, _mm_set1_epi8((char)-n));
+        if ((birth & survive) >> n & 1) {
+          live = _mm_or_si128(live, eq);
+        } else if (birth >> n & 1) {
+          live = _mm_or_si128(live, _mm_andnot_si128(alive, eq));
+        } else if (survive >> n & 1) {
+          live = _mm_or_si128(live, _mm_and_si128(eq, alive));
+        }
+      }
+    }
+    _mm_storeu_si128((__m128i *)(out+y),
+                     _mm_or_si128(_mm_and_si128(live, at), _mm_andnot_si128(live, dash)));
+    diff = _mm_or_si128(diff, _mm_xor_si128(live, alive));
+  }
+#undef NEIGHBOR128
+  *start = y;
+  return _mm_movemask_epi8(diff) != 0;
+}
+
+static inline __attribute__((always_inline, target("avx2")))
+int ruleRowAVX2(const char *up, const char *mid, const char *down, char *out, int *start,
+                int end, int birth, int survive) {
+  // 32 cells per step
+  const __m256i at = _mm256_set1_epi8('@'), dash = _mm256_set1_epi8('-');
+  const __m256i two = _mm256_set1_epi8(-2), three = _mm256_set1_epi8(-3);
+  __m256i diff = _mm256_setzero_si256();
+  int y, n, changed;
+#define NEIGHBOR256(p) _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p)), at)
+  for (y = *start; y + 32 <= end; y += 32) {
+    __m256i cnt = NEIGHBOR256(up+y-1);
+    cnt = _mm256_add_epi8(cnt, NEIGHBOR256(up+y));
+    cnt = _mm256_add_epi8(cnt, NEIGHBOR256(up+y+1));
+    cnt = _mm256_add_epi8(cnt, NEIGHBOR256(mid+y-1));
+    cnt = _mm256_add_epi8(cnt, NEIGHBOR256(mid+y+1));
+    cnt = _mm256_add_epi8(cnt, NEIGHBOR256(down+y-1));
+    cnt = _mm256_add_epi8(cnt, NEIGHBOR256(down+y));
+    cnt = _mm256_add_epi8(cnt, NEIGHBOR256(down+y+1));
+    __m256i alive = NEIGHBOR256(mid+y);
+    __m256i live = _mm256_setzero_si256();
+    if (birth == LIFE_BIRTH && survive == LIFE_SURVIVE) {
+      live = _mm256_or_si256(_mm256_cmpeq_epi8(cnt, three),
+                             _mm256_and_si256(_mm256_cmpeq_epi8(cnt, two), alive));
+    } else {
+#pragma GCC unroll 9
+      for (n = 0; n <= 8; n++) {
+        __m256i eq = _mm256_cmpeq_epi8(cnt, _mm256_set1_epi8((char)-n));
+        if ((birth & survive) >> n & 1) {
+          live = _mm256_or_si256(live, eq);
+        } else if (birth >> n & 1) {
+          live = _mm256_or_si256(live, _mm256_andnot_si256(alive, eq));
+        } else if (survive >> n & 1) {
+          live = _mm256_or_si256(live, _mm256_and_si256(eq, alive));
+        }
+      }
+    }
+    _mm256_storeu_si256((__m256i *)(out+y), _mm256_blendv_epi8(dash, at, live));
+    diff = _mm256_or_si256(diff, _mm256_xor_si256(live, alive));
+  }
+#undef NEIGHBOR256
+  changed = !_mm256_testz_si256(diff, diff);
+  // The SSE2 tail is not VEX-encoded; running it with the upper halves dirty
+  // costs a state transition per call
+  _mm256_zeroupper();
+  *start = y;
+  return changed;
+}
+
+static inline __attribute__((always_inline, target("avx512f,avx512bw")))
+int ruleRowAVX512(const char *up, const char *mid, const char *down, char *out, int *start,
+                  int end, int birth, int survive) {
+  // 64 cells per step; the compares land in mask registers instead
+  const __m512i at = _mm512_set1_epi8('@'), dash = _mm512_set1_epi8('-');
+  const __m512i two = _mm512_set1_epi8(-2), three = _mm512_set1_epi8(-3);
+  __mmask64 diff = 0;
+  int y, n;
+#define NEIGHBOR512(p) _mm512_movm_epi8(_mm512_cmpeq_epi8_mask(_mm512_loadu_si512((const void *)(p)), at))
+  for (y = *start; y + 64 <= end; y += 64) {
+    __m512i cnt = NEIGHBOR512(up+y-1);
+    cnt = _mm512_add_epi8(cnt, NEIGHBOR512(up+y));
+    cnt = _mm512_add_epi8(cnt, NEIGHBOR512(up+y+1));
+    cnt = _mm512_add_epi8(cnt, NEIGHBOR512(mid+y-1));
+    cnt = _mm512_add_epi8(cnt, NEIGHBOR512(mid+y+1));
+    cnt = _mm512_add_epi8(cnt, NEIGHBOR512(down+y-1));
+    cnt = _mm512_add_epi8(cnt, NEIGHBOR512(down+y));
+    cnt = _mm512_add_epi8(cnt, NEIGHBOR512(down+y+1));
+    __mmask64 alive = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512((const void *)(mid+y)), at);
+    __mmask64 live = 0;
+    if (birth == LIFE_BIRTH && survive == LIFE_SURVIVE) {
+      live = _mm512_cmpeq_epi8_mask(cnt, three) | (_mm512_cmpeq_epi8_mask(cnt, two) & alive);
+    } else {
+#pragma GCC unroll 9
+      for (n = 0; n <= 8; n++) {
+        __mmask64 eq = _mm512_cmpeq_epi8_mask(cnt, _mm512_set1_epi8((char)-n));
+        if ((birth & survive) >> n & 1) {
+          live |= eq;
+        } else if (birth >> n & 1) {
+          live |= eq & ~alive;
+        } else if (survive >> n & 1) {
+          live |= eq & alive;
+        }
+      }
+    }
+    _mm512_storeu_si512((void *)(out+y), _mm512_mask_blend_epi8(live, dash, at));
+    diff |= live ^ alive;
+  }
+#undef NEIGHBOR512
+  *start = y;
+  return diff != 0;
+}
+
+// The row kernels of one rule, each vector width finishing its row with the
+// next narrower one. A named rule passes its masks as constants; the table
+// kernels pass on the ones they are called with
+#define ROW_KERNELS(name, B, S)                                                              \
+static int evolveRowScalar##name(const char *up, const char *mid, const char *down,         \
+                                 char *out, int start, int end, int birth, int survive) {  \
+  (void)birth;                                                                               \
+  (void)survive;                                                                             \
+  return ruleRowScalar(up, mid, down, out, start, end, B, S);                                \
+}                                                                                            \
+__attribute__((target("sse2")))                                                              \
+static int evolveRowSSE2##name(const char *up, const char *mid, const char *down,           \
+                               char *out, int start, int end, int birth, int survive) {    \
+  int changed = ruleRowSSE2(up, mid, down, out, &start, end, B, S);                          \
+  return changed | evolveRowScalar##name(up, mid, down, out, start, end, birth, survive);   \
+}                                                                                            \
+__attribute__((target("avx2")))                                                              \
+static int evolveRowAVX2##name(const char *up, const char *mid, const char *down,           \
+                               char *out, int start, int end, int birth, int survive) {    \
+  int changed = ruleRowAVX2(up, mid, down, out, &start, end, B, S);                          \
+  return changed | evolveRowSSE2##name(up, mid, down, out, start, end, birth, survive);     \
+}                                                                                            \
+__attribute__((target("avx512f,avx512bw")))                                                  \
+static int evolveRowAVX512##name(const char *up, const char *mid, const char *down,         \
+                                 char *out, int start, int end, int birth, int survive) {  \
+  int changed = ruleRowAVX512(up, mid, down, out, &start, end, B, S);                        \
+  return changed | evolveRowAVX2##name(up, mid, down, out, start, end, birth, survive);     \
+}
+#else
+#define ROW_KERNELS(name, B, S)                                                              \
+static int evolveRowScalar##name(const char *up, const char *mid, const char *down,         \
+                                 char *out, int start, int end, int birth, int survive) {  \
+  (void)birth;                                                                               \
+  (void)survive;                                                                             \
+  return ruleRowScalar(up, mid, down, out, start, end, B, S);                                \
+}
+#endif
+
+ROW_KERNELS(Life, LIFE_BIRTH, LIFE_SURVIVE)
+ROW_KERNELS(HighLife, HIGHLIFE_BIRTH, HIGHLIFE_SURVIVE)
+ROW_KERNELS(DayNight, DAYNIGHT_BIRTH, DAYNIGHT_SURVIVE)
+ROW_KERNELS(Seeds, SEEDS_BIRTH, SEEDS_SURVIVE)
+ROW_KERNELS(Table, birth, survive)
+
+// Row kernels by rule (RULE_*) and width: scalar, sse2, avx2, avx512
+static const rowKernelFn rowKernels[NUM_RULES][4] = {
+#if defined(__x86_64__) || defined(__i386__)
+  {evolveRowScalarLife, evolveRowSSE2Life, evolveRowAVX2Life, evolveRowAVX512Life},
+  {evolveRowScalarHighLife, evolveRowSSE2HighLife, evolveRowAVX2HighLife,
+   evolveRowAVX512HighLife},
+  {evolveRowScalarDayNight, evolveRowSSE2DayNight, evolveRowAVX2DayNight,
+   evolveRowAVX512DayNight},
+  {evolveRowScalarSeeds, evolveRowSSE2Seeds, evolveRowAVX2Seeds, evolveRowAVX512Seeds},
+  {evolveRowScalarTable, evolveRowSSE2Table, evolveRowAVX2Table, evolveRowAVX512Table},
+#else
+  {evolveRowScalarLife},
+  {evolveRowScalarHighLife},
+  {evolveRowScalarDayNight},
+  {evolveRowScalarSeeds},
+  {evolveRowScalarTable},
+#endif
+};
+
+static int selectKernel(struct golSim *sim) {
+  /*
+   * Purpose: Picks the rule's widest row kernel this CPU supports, unless
+   *          the simd option asked for a particular one
+   * Inputs: Nothing
+   * Returns: 0, or -1 if the CPU lacks the kernel asked for
+   */
+  const rowKernelFn *kernels = rowKernels[sim->ruleKind];
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (!strcmp(sim->simdName, "auto")) {
+    if (__builtin_cpu_supports("avx512bw")) {
+      sim->simdName = "avx512";
+    } else if (__builtin_cpu_supports("avx2")) {
+      sim->simdName = "avx2";
+    } else if (__builtin_cpu_supports("sse2")) {
+      sim->simdName = "sse2";
+    } else {
+      sim->simdName = "scalar";
+    }
+  }
+  if (!strcmp(sim->simdName, "avx512") && __builtin_cpu_supports("avx512bw")) {
+    sim->rowKernel = kernels[3];
+  } else if (!strcmp(sim->simdName, "avx2") && __builtin_cpu_supports("avx2")) {
+    sim->rowKernel = kernels[2];
+  } else if (!strcmp(sim->simdName, "sse2") && __builtin_cpu_supports("sse2")) {
+    sim->rowKernel = kernels[1];
+  } else if (!strcmp(sim->simdName, "scalar")) {
+    sim->rowKernel = kernels[0];
+  } else {
+    return golFail(sim, "Invalid simd option, %s is not supported on this CPU", sim->simdName);
+  }
+#else
+  if (strcmp(sim->simdName, "auto") && strcmp(sim->simdName, "scalar")) {
+    return golFail(sim, "Invalid simd option, %s is not supported on this CPU", sim->simdName);
+  }
+  sim->simdName = "scalar";
+  sim->rowKernel = kernels[0];
+#endif
+  return 0;
+}
+
+static int evolveTile(struct golSim *sim, const char *ref, char *out, struct tile *t) {
+  /*
+   * Purpose: Evolves one tile of the board and refreshes the halo cells it
+   *          feeds
+   * Inputs: Current and next boards: ref, out
+   *         Tile:                    t
+   * Returns: Nonzero if any cell of the tile changed
+   */
+  int x, changed = 0;
+  for (x = t->startRow; x <= t->endRow; x++) {
+    changed |= sim->rowKernel(ref + CELL(x-1,0), ref + CELL(x,0), ref + CELL(x+1,0),
+                              out + CELL(x,0), t->startCol, t->endCol+1, sim->birth,
+                              sim->survive);
+  }
+  refreshHalo(sim, out, t->startRow, t->endRow, t->startCol, t->endCol);
+  return changed;
+}
+
+static void *evolve(void *args) {
+  /*
+   * Purpose: Examines the board and applies the rules of the Game of Life
+   * Inputs: Argument struct: *args
+   * Returns: Nothing
+   */ 
+
+  struct tid_args *my_args = (struct tid_args *)args;
+  struct golSim *sim = my_args->sim;
+  int t, z, changed, skipped, serial;
+  double start = now(), tileStart = 0;
+  uint64_t hash;
+  
+  if (sim->profiling) {
+    startProfile(sim, my_args);
+  }
+  // Loop over the specified number of iterations, or until a cycle is found
+  for(z = 0; z < my_args->iter && z < __atomic_load_n(&sim->stopAt, __ATOMIC_RELAXED); z++) {
+    skipped = 0;
+    if (sim->syncNeighbors) {
+      waitNeighbors(sim, my_args, z);
+      if (sim->profiling) {
+        endPhase(sim, my_args, PHASE_WAIT, z);
+      }
+    }
+    if (sim->ckptDue[z%2]) {
+      packRows(sim, sim->ckptData, sim->boards[z%2], sim->bitBoards[z%2],
+               (int)((long)sim->rows*my_args->my_tid/sim->threadCount),
+               (int)((long)sim->rows*(my_args->my_tid+1)/sim->threadCount) - 1);
+    }
+    if (sim->frameDue[z%2] >= 0) {
+      packRows(sim, sim->frames[sim->frameDue[z%2]].cells, sim->boards[z%2], sim->bitBoards[z%2],
+               (int)((long)sim->rows*my_args->my_tid/sim->threadCount),
+               (int)((long)sim->rows*(my_args->my_tid+1)/sim->threadCount) - 1);
+    }
+    while ((t = nextTile(sim, my_args, z)) >= 0) {
+      if (sim->activeTiles && !tileActive(sim, t, z)) {
+        sim->tileChanged[(z+1)%2][t] = 0;
+        skipped++;
+        continue;
+      }
+      if (sim->timeTiles) {
+        tileStart = now();
+      }
+      if (sim->engine == GOL_ENGINE_BIT) {
+        changed = evolveBitTile(sim, sim->bitBoards[z%2], sim->bitBoards[(z+1)%2], &sim->tiles[t]);
+      } else {
+        changed = evolveTile(sim, sim->boards[z%2], sim->boards[(z+1)%2], &sim->tiles[t]);
+      }
+      if (sim->activeTiles) {
+        sim->tileChanged[(z+1)%2][t] = changed;
+      }
+      if (sim->hashing && changed) {
+        hash = hashTile(sim, sim->boards[(z+1)%2], sim->bitBoards[(z+1)%2], &sim->tiles[t]);
+        my_args->hashDelta[z%2] ^= sim->tileHash[t] ^ hash;
+        sim->tileHash[t] = hash;
+      }
+      if (sim->timeTiles) {
+        my_args->busy += now() - tileStart;
+      }
+      my_args->tilesDone++;
+    }
+    if (sim->syncNeighbors) {
+      // Nobody finishes generations here, so skips go straight to the total
+      __atomic_fetch_add(&sim->totalSkipped, skipped, __ATOMIC_RELAXED);
+      publishGeneration(sim, my_args, z+1);
+      if (sim->profiling) {
+        endPhase(sim, my_args, PHASE_COMPUTE, z);
+      }
+      continue;
+    }
+    if (skipped) {
+      __atomic_fetch_add(&sim->skippedTiles[z%2], skipped, __ATOMIC_RELAXED);
+    }
+    if (sim->workStealing) {
+      fillDeque(&sim->deques[(z+1)%2][my_args->my_tid], my_args);
+    }
+    if (sim->profiling) {
+      endPhase(sim, my_args, PHASE_COMPUTE, z);
+    }
+    serial = pthread_barrier_wait(&sim->barrier) == PTHREAD_BARRIER_SERIAL_THREAD;
+    if (sim->profiling) {
+      endPhase(sim, my_args, PHASE_WAIT, z);
+    }
+    if (serial) {
+      finishGeneration(sim, z);
+      if (sim->profiling) {
+        endPhase(sim, my_args, PHASE_SERIAL, z);
+      }
+    }
+  }
+  if (sim->profiling) {
+    stopProfile(sim, my_args);
+  }
+  my_args->total = now() - start;
+  return NULL;
+}
+
+static int tileActive(struct golSim *sim, int t, int iter) {
+  /*
+   * Purpose: Decides whether step iter has to evolve tile t, which it does if
+   *          the tile or any tile around it changed in the last step. On a
+   *          torus the tiles along one edge neighbor those on the other
+   * Inputs: Tile index:        t
+   *         Current iteration: iter
+   * Returns: 1 if the tile must be evolved, 0 if it can be skipped
+   */
+  const unsigned char *changed = sim->tileChanged[iter%2];
+  int r = t / sim->tilesAcross, c = t % sim->tilesAcross;
+  int dr, dc, nr, nc;
+  for (dr = -1; dr <= 1; dr++) {
+    for (dc = -1; dc <= 1; dc++) {
+      nr = r+dr;
+      nc = c+dc;
+      if (sim->deadBoundary && (nr < 0 || nr >= sim->tilesDown || nc < 0 ||
+                                nc >= sim->tilesAcross)) {
+        continue;
+      }
+      nr = (nr+sim->tilesDown) % sim->tilesDown;
+      nc = (nc+sim->tilesAcross) % sim->tilesAcross;
+      if (changed[nr*sim->tilesAcross+nc]) {
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+static void makeTileChanged(struct golSim *sim) {
+  /*
+   * Purpose: Allocates the change bits. Generation 0 counts as changed
+   *          everywhere, so the first step evolves every tile
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  int p;
+  for (p = 0; p < 2; p++) {
+    if (!(sim->tileChanged[p] = (unsigned char *)malloc(sim->totalTiles))) {
+      printf("malloc error\n");
+      exit(1);
+    }
+    memset(sim->tileChanged[p], !p, sim->totalTiles);
+  }
+}
+
+static void *evolveBlocked(void *args) {
+  /*
+   * Purpose: evolve with haloDepth > 1: runs each tile haloDepth generations
+   *          at a time in private buffers between barriers
+   * Inputs: Argument struct: *args
+   * Returns: Nothing
+   */
+  struct tid_args *my_args = (struct tid_args *)args;
+  struct golSim *sim = my_args->sim;
+  int k = sim->haloDepth, maxH = 0, maxW = 0, supersteps, steps, s, t, serial;
+  double start = now(), tileStart = 0;
+  char *bufs[2];
+
+  // Size the buffers for the largest tile, which a thief may end up with
+  for (t = 0; t < sim->totalTiles; t++) {
+    if (sim->tiles[t].endRow-sim->tiles[t].startRow+1 > maxH) {
+      maxH = sim->tiles[t].endRow-sim->tiles[t].startRow+1;
+    }
+    if (sim->tiles[t].endCol-sim->tiles[t].startCol+1 > maxW) {
+      maxW = sim->tiles[t].endCol-sim->tiles[t].startCol+1;
+    }
+  }
+  for (s = 0; s < 2; s++) {
+    if (!(bufs[s] = (char *)malloc((size_t)(maxH+2*k)*(maxW+2*k)))) {
+      printf("malloc error\n");
+      exit(1);
+    }
+  }
+
+  if (sim->profiling) {
+    startProfile(sim, my_args);
+  }
+  supersteps = (my_args->iter+k-1)/k;
+  for (s = 0; s < supersteps; s++) {
+    steps = (my_args->iter - s*k < k) ? my_args->iter - s*k : k;
+    if (sim->frameDue[s%2] >= 0) {
+      packRows(sim, sim->frames[sim->frameDue[s%2]].cells, sim->boards[s%2], NULL,
+               (int)((long)sim->rows*my_args->my_tid/sim->threadCount),
+               (int)((long)sim->rows*(my_args->my_tid+1)/sim->threadCount) - 1);
+    }
+    while ((t = nextTile(sim, my_args, s)) >= 0) {
+      if (sim->timeTiles) {
+        tileStart = now();
+      }
+      loadBlock(sim, bufs[0], sim->boards[s%2], &sim->tiles[t], k);
+      evolveBlock(sim, bufs, sim->boards[(s+1)%2], &sim->tiles[t], k, steps);
+      if (sim->timeTiles) {
+        my_args->busy += now() - tileStart;
+      }
+      my_args->tilesDone++;
+    }
+    if (sim->workStealing) {
+      fillDeque(&sim->deques[(s+1)%2][my_args->my_tid], my_args);
+    }
+    if (sim->profiling) {
+      endPhase(sim, my_args, PHASE_COMPUTE, s);
+    }
+    serial = pthread_barrier_wait(&sim->barrier) == PTHREAD_BARRIER_SERIAL_THREAD;
+    if (sim->profiling) {
+      endPhase(sim, my_args, PHASE_WAIT, s);
+    }
+    if (serial) {
+      finishGeneration(sim, s);
+      if (sim->profiling) {
+        endPhase(sim, my_args, PHASE_SERIAL, s);
+      }
+    }
+  }
+  if (sim->profiling) {
+    stopProfile(sim, my_args);
+  }
+  free(bufs[0]);
+  free(bufs[1]);
+  my_args->total = now() - start;
+  return NULL;
+}
+
+static void loadBlock(struct golSim *sim, char *buf, const char *board, struct tile *t, int depth) {
+  /*
+   * Purpose: Copies a tile and depth cells around it into a private buffer,
+   *          wrapping around the torus or reading dead cells past the edge
+   * Inputs: Buffer and board: buf, board
+   *         Tile and border:  t, depth
+   * Returns: Nothing
+   */
+  int h = t->endRow-t->startRow+1, w = t->endCol-t->startCol+1;
+  int bw = w+2*depth, r, c, x, y;
+  char *row;
+  for (r = -depth; r < h+depth; r++) {
+    row = buf + (size_t)(r+depth)*bw + depth;
+    x = t->startRow + r;
+    if (sim->deadBoundary && (x < 0 || x >= sim->rows)) {
+      memset(row-depth, '-', bw);
+      continue;
+    }
+    x = ((x % sim->rows) + sim->rows) % sim->rows;
+    memcpy(row, board + CELL(x,t->startCol), w);
+    for (c = -depth; c < 0; c++) {
+      y = t->startCol + c;
+      row[c] = (sim->deadBoundary && y < 0) ? '-' :
+               board[CELL(x,((y % sim->cols) + sim->cols) % sim->cols)];
+    }
+    for (c = w; c < w+depth; c++) {
+      y = t->startCol + c;
+      row[c] = (sim->deadBoundary && y >= sim->cols) ? '-' : board[CELL(x,y % sim->cols)];
+    }
+  }
+}
+
+static void evolveBlock(struct golSim *sim, char *bufs[2], char *out, struct tile *t, int depth,
+                        int steps) {
+  /*
+   * Purpose: Runs a loaded block steps generations, each one computing a
+   *          cell less of border than the last, and stores the tile into the
+   *          next superstep's board. With a dead boundary the cells past the
+   *          board's edge are never computed, so they stay dead
+   * Inputs: Private buffers, bufs[0] loaded: bufs
+   *         Next superstep's board:          out
+   *         Tile and border:                 t, depth
+   *         Generations to run:              steps
+   * Returns: Nothing
+   */
+  int h = t->endRow-t->startRow+1, w = t->endCol-t->startCol+1;
+  int bw = w+2*depth, i, r, m, first, last, left, right;
+  const char *src;
+  char *dst;
+
+  // Past a dead edge both buffers must read as dead
+  if (sim->deadBoundary && (t->startRow < depth || t->endRow+depth >= sim->rows ||
+                       t->startCol < depth || t->endCol+depth >= sim->cols)) {
+    memcpy(bufs[1], bufs[0], (size_t)(h+2*depth)*bw);
+  }
+  for (i = 1; i <= steps; i++) {
+    src = bufs[(i-1)%2] + depth;
+    dst = bufs[i%2] + depth;
+    m = depth-i;
+    first = -m;
+    last = h+m-1;
+    left = -m;
+    right = w+m;
+    if (sim->deadBoundary) {
+      first = first > -t->startRow ? first : -t->startRow;
+      last = last < sim->rows-1-t->startRow ? last : sim->rows-1-t->startRow;
+      left = left > -t->startCol ? left : -t->startCol;
+      right = right < sim->cols-t->startCol ? right : sim->cols-t->startCol;
+    }
+    for (r = first; r <= last; r++) {
+      sim->rowKernel(src + (size_t)(r-1+depth)*bw, src + (size_t)(r+depth)*bw,
+                src + (size_t)(r+1+depth)*bw, dst + (size_t)(r+depth)*bw, left, right,
+                sim->birth, sim->survive);
+    }
+  }
+  src = bufs[steps%2] + depth;
+  for (r = 0; r < h; r++) {
+    memcpy(out + CELL(t->startRow+r,t->startCol), src + (size_t)(r+depth)*bw, w);
+  }
+  refreshHalo(sim, out, t->startRow, t->endRow, t->startCol, t->endCol);
+}
+
+static void makeNeighbors(struct golSim *sim, struct tid_args *thread_args, int numTids) {
+  /*
+   * Purpose: Lists, for each thread, the other threads owning a tile next
+   *          to one of its own (wrapping around a torus), and zeroes the
+   *          generation counters. Threads only spin while waiting if there
+   *          are enough CPUs to go around
+   * Inputs: Arg struct:   *thread_args
+   *         # of threads: numTids
+   * Returns: Nothing
+   */
+  int *owner = (int *)malloc(sizeof(int)*sim->totalTiles);
+  int *seen = (int *)malloc(sizeof(int)*numTids);
+  int i, t, r, c, dr, dc, nr, nc, nbr;
+  if (!owner || !seen || posix_memalign((void **)&sim->counters, CACHE_LINE,
+                                        sizeof(struct syncCounter)*numTids)) {
+    printf("malloc error\n");
+    exit(1);
+  }
+  memset(sim->counters, 0, sizeof(struct syncCounter)*numTids);
+  sim->spinLimit = numTids <= sysconf(_SC_NPROCESSORS_ONLN) ? SPIN_LIMIT : 0;
+  for (i = 0; i < numTids; i++) {
+    for (t = thread_args[i].firstTile; t < thread_args[i].firstTile+thread_args[i].numTiles; t++) {
+      owner[t] = i;
+    }
+    seen[i] = -1;
+  }
+  for (i = 0; i < numTids; i++) {
+    if (!(thread_args[i].neighbors = (int *)malloc(sizeof(int)*numTids))) {
+      printf("malloc error\n");
+      exit(1);
+    }
+    thread_args[i].numNeighbors = 0;
+    seen[i] = i;
+    for (t = thread_args[i].firstTile; t < thread_args[i].firstTile+thread_args[i].numTiles; t++) {
+      r = t / sim->tilesAcross;
+      c = t % sim->tilesAcross;
+      for (dr = -1; dr <= 1; dr++) {
+        for (dc = -1; dc <= 1; dc++) {
+          nr = r+dr;
+          nc = c+dc;
+          if (sim->deadBoundary && (nr < 0 || nr >= sim->tilesDown || nc < 0 ||
+                                    nc >= sim->tilesAcross)) {
+            continue;
+          }
+          nbr = owner[((nr+sim->tilesDown) % sim->tilesDown)*sim->tilesAcross +
+                      (nc+sim->tilesAcross) % sim->tilesAcross];
+          if (seen[nbr] != i) {
+            seen[nbr] = i;
+            thread_args[i].neighbors[thread_args[i].numNeighbors++] = nbr;
+          }
+        }
+      }
+    }
+  }
+  free(owner);
+  free(seen);
+}
+
+static void freeNeighbors(struct golSim *sim, struct tid_args *thread_args, int numTids) {
+  /*
+   * Purpose: Releases the neighbor lists and generation counters
+   * Inputs: Arg struct:   *thread_args
+   *         # of threads: numTids
+   * Returns: Nothing
+   */
+  int i;
+  for (i = 0; i < numTids; i++) {
+    free(thread_args[i].neighbors);
+  }
+  free(sim->counters);
+}
+
+static void waitNeighbors(struct golSim *sim, struct tid_args *my_args, int gen) {
+  /*
+   * Purpose: Blocks until every neighbor has finished generation gen
+   * Inputs: Argument struct: my_args
+   *         Generation:      gen
+   * Returns: Nothing
+   */
+  int i;
+  for (i = 0; i < my_args->numNeighbors; i++) {
+    waitCounter(sim, &sim->counters[my_args->neighbors[i]], gen, FUTEX_WAIT_PRIVATE);
+  }
+}
+
+static void waitCounter(struct golSim *sim, struct syncCounter *c, int gen, int op) {
+  /*
+   * Purpose: Blocks until a generation counter reaches gen, spinning
+   *          briefly and then sleeping on it
+   * Inputs: Counter:     c
+   *         Generation:  gen
+   *         Futex wait:  op, FUTEX_WAIT_PRIVATE, or FUTEX_WAIT for a
+   *                      counter other processes post to
+   * Returns: Nothing
+   */
+  int spins, seen;
+  for (spins = 0; (seen = __atomic_load_n(&c->done, __ATOMIC_ACQUIRE)) < gen; spins++) {
+    if (spins < sim->spinLimit) {
+#if defined(__x86_64__) || defined(__i386__)
+      _mm_pause();
+#endif
+      continue;
+    }
+    // Announce the sleep before rechecking, so postCounter either sees the
+    // waiter or the recheck sees its new count
+    __atomic_fetch_add(&c->waiters, 1, __ATOMIC_SEQ_CST);
+    if ((seen = __atomic_load_n(&c->done, __ATOMIC_SEQ_CST)) < gen) {
+      syscall(SYS_futex, &c->done, op, seen, NULL, NULL, 0);
+    }
+    __atomic_fetch_sub(&c->waiters, 1, __ATOMIC_SEQ_CST);
+  }
+}
+
+static void postCounter(struct syncCounter *c, int gen, int op) {
+  /*
+   * Purpose: Moves a generation counter to gen, waking any waiters
+   * Inputs: Counter:     c
+   *         Generation:  gen
+   *         Futex wake:  op, FUTEX_WAKE_PRIVATE or FUTEX_WAKE
+   * Returns: Nothing
+   */
+  __atomic_store_n(&c->done, gen, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&c->waiters, __ATOMIC_SEQ_CST)) {
+    syscall(SYS_futex, &c->done, op, INT_MAX, NULL, NULL, 0);
+  }
+}
+
+static void publishGeneration(struct golSim *sim, struct tid_args *my_args, int gen) {
+  /*
+   * Purpose: Tells the neighbors this thread has finished generation gen,
+   *          waking any that went to sleep waiting for it
+   * Inputs: Argument struct: my_args
+   *         Generation:      gen
+   * Returns: Nothing
+   */
+  postCounter(&sim->counters[my_args->my_tid], gen, FUTEX_WAKE_PRIVATE);
+}
+
+static void poolStart(struct golSim *sim, struct tid_args *thread_args, int numTids) {
+  /*
+   * Purpose: Creates the pool's worker threads. With pinThreads worker i is
+   *          bound from birth to the i-th CPU this process may run on,
+   *          wrapping around when there are more workers than CPUs. An
+   *          unpinned pool of one has no thread at all: its jobs run on the
+   *          caller, which saves a thread per board when many small
+   *          simulations run side by side
+   * Inputs: Arg struct:   *thread_args
+   *         # of threads: numTids
+   * Returns: Nothing
+   */
+  cpu_set_t allowed, one;
+  pthread_attr_t attr;
+  int i, cpu, skip;
+
+  if (numTids == 1 && !sim->pinThreads) {
+    thread_args[0].sim = sim;
+    thread_args[0].my_tid = 0;
+    thread_args[0].pinCpu = -1;
+    return;
+  }
+  sim->poolSize = numTids;
+  if (!(sim->poolTids = (pthread_t *)malloc(sizeof(pthread_t)*numTids))) {
+    printf("malloc error\n");
+    exit(1);
+  }
+  if (sim->pinThreads && sched_getaffinity(0, sizeof(allowed), &allowed)) {
+    perror("sched_getaffinity");
+    exit(1);
+  }
+  for (i = 0; i < numTids; i++) {
+    pthread_attr_init(&attr);
+    thread_args[i].sim = sim;
+    thread_args[i].my_tid = i;
+    thread_args[i].pinCpu = -1;
+    if (sim->pinThreads) {
+      skip = i % CPU_COUNT(&allowed);
+      for (cpu = 0; !CPU_ISSET(cpu, &allowed) || skip--; cpu++) {
+      }
+      thread_args[i].pinCpu = cpu;
+      CPU_ZERO(&one);
+      CPU_SET(cpu, &one);
+      pthread_attr_setaffinity_np(&attr, sizeof(one), &one);
+    }
+    if (pthread_create(&sim->poolTids[i], &attr, poolWorker, (void *)&thread_args[i])) {
+      perror("Error pthread_create\n");
+      exit(1);
+    }
+    pthread_attr_destroy(&attr);
+  }
+}
+
+static void *poolWorker(void *args) {
+  /*
+   * Purpose: Body of a pool thread: waits for each new job, notes where it
+   *          is running, runs the job and reports back
+   * Inputs: Argument struct: *args
+   * Returns: Nothing
+   */
+  struct tid_args *my_args = (struct tid_args *)args;
+  struct golSim *sim = my_args->sim;
+  void *(*job)(void *);
+  unsigned cpu, node;
+  int seen = 0;
+
+  for (;;) {
+    pthread_mutex_lock(&sim->poolLock);
+    while (sim->poolJobId == seen && !sim->poolQuit) {
+      pthread_cond_wait(&sim->poolWake, &sim->poolLock);
+    }
+    if (sim->poolQuit) {
+      pthread_mutex_unlock(&sim->poolLock);
+      return NULL;
+    }
+    seen = sim->poolJobId;
+    job = sim->poolJob;
+    pthread_mutex_unlock(&sim->poolLock);
+
+    if (syscall(SYS_getcpu, &cpu, &node, NULL)) {
+      cpu = node = -1;
+    }
+    my_args->cpu = cpu;
+    my_args->node = node;
+    job(my_args);
+
+    pthread_mutex_lock(&sim->poolLock);
+    if (--sim->poolRunning == 0) {
+      pthread_cond_signal(&sim->poolIdle);
+    }
+    pthread_mutex_unlock(&sim->poolLock);
+  }
+}
+
+static void poolRun(struct golSim *sim, void *(*job)(void *)) {
+  /*
+   * Purpose: Runs a job on every pool thread, or on the caller for a pool
+   *          of one, and waits for all of them
+   * Inputs: Job: job
+   * Returns: Nothing
+   */
+  unsigned cpu, node;
+  if (!sim->poolSize) {
+    if (syscall(SYS_getcpu, &cpu, &node, NULL)) {
+      cpu = node = -1;
+    }
+    sim->thread_args[0].cpu = cpu;
+    sim->thread_args[0].node = node;
+    job(&sim->thread_args[0]);
+    return;
+  }
+  pthread_mutex_lock(&sim->poolLock);
+  sim->poolJob = job;
+  sim->poolRunning = sim->poolSize;
+  sim->poolJobId++;
+  pthread_cond_broadcast(&sim->poolWake);
+  while (sim->poolRunning) {
+    pthread_cond_wait(&sim->poolIdle, &sim->poolLock);
+  }
+  pthread_mutex_unlock(&sim->poolLock);
+}
+
+static void poolStop(struct golSim *sim) {
+  /*
+   * Purpose: Shuts the pool's threads down
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  int i;
+  pthread_mutex_lock(&sim->poolLock);
+  sim->poolQuit = 1;
+  pthread_cond_broadcast(&sim->poolWake);
+  pthread_mutex_unlock(&sim->poolLock);
+  for (i = 0; i < sim->poolSize; i++) {
+    pthread_join(sim->poolTids[i], 0);
+  }
+  free(sim->poolTids);
+}
+
+static void printPlacement(struct golSim *sim, struct tid_args *thread_args, int numTids) {
+  /*
+   * Purpose: Reports which CPU and node each thread last ran on, and which
+   *          nodes hold the pages of the current board under its tiles
+   * Inputs: Arg struct:   *thread_args
+   *         # of threads: numTids
+   * Returns: Nothing
+   */
+  long page = sysconf(_SC_PAGESIZE), perNode[MAX_NODES], unplaced;
+  size_t numPages, maxPages = 1024, i;
+  void **pages = (void **)malloc(sizeof(void *)*maxPages);
+  int *status = (int *)malloc(sizeof(int)*maxPages);
+  int unit = (sim->engine == GOL_ENGINE_BIT) ? sizeof(uint64_t) : 1;
+  int tid, t, x, n;
+  uintptr_t addr, end;
+
+  for (tid = 0; tid < numTids; tid++) {
+    memset(perNode, 0, sizeof(perNode));
+    unplaced = 0;
+    numPages = 0;
+    for (t = thread_args[tid].firstTile; t < thread_args[tid].firstTile+thread_args[tid].numTiles; t++) {
+      for (x = sim->tiles[t].startRow; x <= sim->tiles[t].endRow; x++) {
+        addr = (sim->engine == GOL_ENGINE_BIT) ? (uintptr_t)(sim->refBits + WORD(x,sim->tiles[t].startCol))
+                                      : (uintptr_t)(sim->refBoard + CELL(x,sim->tiles[t].startCol));
+        end = addr + (sim->tiles[t].endCol-sim->tiles[t].startCol+1)*unit;
+        for (addr &= ~(uintptr_t)(page-1); addr < end; addr += page) {
+          if (numPages && pages[numPages-1] == (void *)addr) {
+            continue;
+          }
+          if (numPages == maxPages) {
+            maxPages *= 2;
+            pages = (void **)realloc(pages, sizeof(void *)*maxPages);
+            status = (int *)realloc(status, sizeof(int)*maxPages);
+          }
+          if (!pages || !status) {
+            printf("malloc error\n");
+            exit(1);
+          }
+          pages[numPages++] = (void *)addr;
+        }
+      }
+    }
+    // With no target nodes, move_pages only reports where each page is
+    if (numPages && syscall(SYS_move_pages, 0, numPages, pages, NULL, status, 0)) {
+      for (i = 0; i < numPages; i++) {
+        status[i] = -1;
+      }
+    }
+    for (i = 0; i < numPages; i++) {
+      if (status[i] >= 0 && status[i] < MAX_NODES) {
+        perNode[status[i]]++;
+      } else {
+        unplaced++;
+      }
+    }
+    printf("tid %d: cpu %d node %d pages:", thread_args[tid].my_tid, thread_args[tid].cpu,
+           thread_args[tid].node);
+    for (n = 0; n < MAX_NODES; n++) {
+      if (perNode[n]) {
+        printf(" node%d %ld", n, perNode[n]);
+      }
+    }
+    if (unplaced) {
+      printf(" unknown %ld", unplaced);
+    }
+    printf("\n");
+  }
+  free(pages);
+  free(status);
+}
+
+static double now(void) {
+  /*
+   * Purpose: Reads a monotonic clock
+   * Returns: Seconds since an arbitrary start
+   */
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+static void makeDeques(struct golSim *sim, struct tid_args *thread_args, int numTids) {
+  /*
+   * Purpose: Allocates both sets of deques and fills the first generation's
+   * Inputs: Arg struct:   *thread_args
+   *         # of threads: numTids
+   * Returns: Nothing
+   */
+  int p, i;
+  for (p = 0; p < 2; p++) {
+    if (!(sim->deques[p] = (struct deque *)malloc(sizeof(struct deque)*numTids))) {
+      printf("malloc error\n");
+      exit(1);
+    }
+    for (i = 0; i < numTids; i++) {
+      struct deque *dq = &sim->deques[p][i];
+      pthread_mutex_init(&dq->lock, NULL);
+      if (!(dq->items = (int *)malloc(sizeof(int)*(thread_args[i].numTiles+1)))) {
+        printf("malloc error\n");
+        exit(1);
+      }
+      dq->top = dq->bottom = 0;
+    }
+  }
+  for (i = 0; i < numTids; i++) {
+    fillDeque(&sim->deques[0][i], &thread_args[i]);
+  }
+}
+
+static void freeDeques(struct golSim *sim, int numTids) {
+  /*
+   * Purpose: Releases the deques
+   * Inputs: # of threads: numTids
+   * Returns: Nothing
+   */
+  int p, i;
+  for (p = 0; p < 2; p++) {
+    for (i = 0; i < numTids; i++) {
+      pthread_mutex_destroy(&sim->deques[p][i].lock);
+      free(sim->deques[p][i].items);
+    }
+    free(sim->deques[p]);
+  }
+}
+
+static void fillDeque(struct deque *dq, struct tid_args *my_args) {
+  /*
+   * Purpose: Loads a thread's own tiles into its deque, last tile first so
+   *          the owner pops them in row-major order and thieves take from
+   *          the far end of its run
+   * Inputs: Deque:           dq
+   *         Argument struct: my_args
+   * Returns: Nothing
+   */
+  int i;
+  pthread_mutex_lock(&dq->lock);
+  for (i = 0; i < my_args->numTiles; i++) {
+    dq->items[i] = my_args->firstTile + my_args->numTiles-1 - i;
+  }
+  dq->top = 0;
+  dq->bottom = my_args->numTiles;
+  pthread_mutex_unlock(&dq->lock);
+}
+
+static int nextTile(struct golSim *sim, struct tid_args *my_args, int iter) {
+  /*
+   * Purpose: Hands a thread its next tile of the current generation: the
+   *          next of its own run with the static scheduler, else the bottom
+   *          of its deque or, once that is empty, the top of someone else's
+   * Inputs: Argument struct:   my_args
+   *         Current iteration: iter
+   * Returns: Tile index, or -1 when the generation has no tiles left
+   */
+  struct deque *dq;
+  int i, t = -1;
+
+  if (!sim->workStealing) {
+    if (my_args->cursor < my_args->numTiles) {
+      return my_args->firstTile + my_args->cursor++;
+    }
+    my_args->cursor = 0;
+    return -1;
+  }
+
+  for (i = 0; i < sim->threadCount && t < 0; i++) {
+    dq = &sim->deques[iter%2][(my_args->my_tid+i) % sim->threadCount];
+    pthread_mutex_lock(&dq->lock);
+    if (dq->top < dq->bottom) {
+      t = i ? dq->items[dq->top++] : dq->items[--dq->bottom];
+    }
+    pthread_mutex_unlock(&dq->lock);
+    if (t >= 0 && i) {
+      my_args->tilesStolen++;
+    }
+  }
+  return t;
+}
+
+static void printLoadBalance(struct golSim *sim, struct tid_args *thread_args, int numTids) {
+  /*
+   * Purpose: Reports how many tiles each thread evolved and, if its tiles
+   *          were timed, how long it spent on them versus waiting for work
+   *          or at the barrier
+   * Inputs: Arg struct:   *thread_args
+   *         # of threads: numTids
+   * Returns: Nothing
+   */
+  int i;
+  for (i = 0; i < numTids; i++) {
+    if (sim->timeTiles) {
+      printf("tid %d: busy %f s idle %f s tiles %d (%d stolen)\n", thread_args[i].my_tid,
+             thread_args[i].busy, thread_args[i].total - thread_args[i].busy,
+             thread_args[i].tilesDone, thread_args[i].tilesStolen);
+    } else {
+      printf("tid %d: tiles %d (%d stolen)\n", thread_args[i].my_tid,
+             thread_args[i].tilesDone, thread_args[i].tilesStolen);
+    }
+  }
+}
+
+static void makeProfiles(struct golSim *sim, int numTids, int steps) {
+  /*
+   * Purpose: Allocates each thread's profile and, with trace on, room for
+   *          its events: at most three a step, up to TRACE_EVENTS
+   * Inputs: # of threads:         numTids
+   *         Steps in this run:    steps
+   * Returns: Nothing
+   */
+  int i;
+  if (!(sim->profiles = (struct profile *)calloc(numTids, sizeof(struct profile)))) {
+    printf("malloc error\n");
+    exit(1);
+  }
+  for (i = 0; sim->trace && i < numTids; i++) {
+    sim->profiles[i].maxTrace = (3L*steps < TRACE_EVENTS) ? 3*steps : TRACE_EVENTS;
+    if (!(sim->profiles[i].trace = (struct traceEvent *)malloc(
+            (size_t)(sim->profiles[i].maxTrace ? sim->profiles[i].maxTrace : 1)*sizeof(struct traceEvent)))) {
+      printf("malloc error\n");
+      exit(1);
+    }
+  }
+}
+
+static void openCounters(struct golSim *sim, struct profile *p) {
+  /*
+   * Purpose: Opens the hardware counters of the calling thread as one group,
+   *          counting user-space events only. Where perf_event_open is not
+   *          allowed the run goes on with timing alone
+   * Inputs: Thread's profile: p
+   * Returns: Nothing
+   */
+  static const uint64_t configs[NUM_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+  };
+  struct perf_event_attr attr;
+  int c;
+  for (c = 0; c < NUM_COUNTERS; c++) {
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = configs[c];
+    attr.disabled = (c == 0);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    p->perfFds[c] = syscall(SYS_perf_event_open, &attr, 0, -1, c ? p->perfFds[0] : -1, 0);
+    if (p->perfFds[c] < 0) {
+      if (!__atomic_exchange_n(&sim->countersWarned, 1, __ATOMIC_RELAXED)) {
+        printf("Hardware counters unavailable (%s), timing only\n", strerror(errno));
+      }
+      while (--c >= 0) {
+        close(p->perfFds[c]);
+      }
+      p->perfFds[0] = -1;
+      return;
+    }
+  }
+  ioctl(p->perfFds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+static void readCounters(struct profile *p, uint64_t *values) {
+  /*
+   * Purpose: Reads the whole counter group in one call
+   * Inputs: Thread's profile:   p
+   *         Counts read, out:   values
+   * Returns: Nothing
+   */
+  uint64_t group[1 + NUM_COUNTERS];
+  if (p->perfFds[0] < 0 || read(p->perfFds[0], group, sizeof(group)) != sizeof(group)) {
+    memset(values, 0, NUM_COUNTERS*sizeof(uint64_t));
+    return;
+  }
+  memcpy(values, group+1, NUM_COUNTERS*sizeof(uint64_t));
+}
+
+static void startProfile(struct golSim *sim, struct tid_args *my_args) {
+  /*
+   * Purpose: Starts a worker's first phase, opening its counters first
+   * Inputs: Argument struct: my_args
+   * Returns: Nothing
+   */
+  struct profile *p = &sim->profiles[my_args->my_tid];
+  p->perfFds[0] = -1;
+  if (sim->hwCounters) {
+    openCounters(sim, p);
+  }
+  readCounters(p, p->last);
+  p->mark = now();
+}
+
+static void endPhase(struct golSim *sim, struct tid_args *my_args, int phase, int gen) {
+  /*
+   * Purpose: Ends a worker's current phase, charging it the time and events
+   *          since the last one ended, and starts the next
+   * Inputs: Argument struct:      my_args
+   *         Phase that just ended: phase
+   *         Step it belongs to:    gen
+   * Returns: Nothing
+   */
+  struct profile *p = &sim->profiles[my_args->my_tid];
+  uint64_t values[NUM_COUNTERS], delta[NUM_COUNTERS];
+  double t = now();
+  int c;
+  p->time[phase] += t - p->mark;
+  readCounters(p, values);
+  for (c = 0; c < NUM_COUNTERS; c++) {
+    delta[c] = values[c] - p->last[c];
+    p->counts[phase][c] += delta[c];
+    p->last[c] = values[c];
+  }
+  if (sim->trace) {
+    if (p->numTrace < p->maxTrace) {
+      struct traceEvent *event = &p->trace[p->numTrace++];
+      event->start = p->mark - sim->traceBase;
+      event->dur = t - p->mark;
+      event->gen = sim->genBase + gen;
+      event->phase = phase;
+      memcpy(event->counts, delta, sizeof(delta));
+    } else {
+      p->dropped++;
+    }
+  }
+  p->mark = t;
+}
+
+static void stopProfile(struct golSim *sim, struct tid_args *my_args) {
+  /*
+   * Purpose: Closes a worker's counters
+   * Inputs: Argument struct: my_args
+   * Returns: Nothing
+   */
+  struct profile *p = &sim->profiles[my_args->my_tid];
+  int c;
+  for (c = 0; p->perfFds[0] >= 0 && c < NUM_COUNTERS; c++) {
+    close(p->perfFds[c]);
+  }
+}
+
+static void printProfile(struct golSim *sim, int numTids) {
+  /*
+   * Purpose: Reports each thread's time per phase and, with hwCounters, the
+   *          hardware events of each phase summed over the threads
+   * Inputs: # of threads: numTids
+   * Returns: Nothing
+   */
+  uint64_t totals[NUM_PHASES][NUM_COUNTERS] = {{0}};
+  int i, ph, c;
+  for (i = 0; i < numTids; i++) {
+    printf("tid %d: compute %f s wait %f s serial %f s\n", i, sim->profiles[i].time[PHASE_COMPUTE],
+           sim->profiles[i].time[PHASE_WAIT], sim->profiles[i].time[PHASE_SERIAL]);
+    for (ph = 0; ph < NUM_PHASES; ph++) {
+      for (c = 0; c < NUM_COUNTERS; c++) {
+        totals[ph][c] += sim->profiles[i].counts[ph][c];
+      }
+    }
+  }
+  if (!sim->hwCounters || sim->countersWarned) {
+    return;
+  }
+  printf("%-14s %16s %16s %16s\n", "counter", "compute", "wait", "serial");
+  for (c = 0; c < NUM_COUNTERS; c++) {
+    printf("%-14s %16llu %16llu %16llu\n", counterNames[c],
+           (unsigned long long)totals[PHASE_COMPUTE][c], (unsigned long long)totals[PHASE_WAIT][c],
+           (unsigned long long)totals[PHASE_SERIAL][c]);
+  }
+  if (totals[PHASE_COMPUTE][0]) {
+    printf("Compute IPC %.2f, %.2f LLC misses per 1000 instructions\n",
+           (double)totals[PHASE_COMPUTE][1]/totals[PHASE_COMPUTE][0],
+           totals[PHASE_COMPUTE][1] ? 1000.0*totals[PHASE_COMPUTE][2]/totals[PHASE_COMPUTE][1] : 0.0);
+  }
+}
+
+static int writeTrace(struct golSim *sim, const char *filename, int numTids) {
+  /*
+   * Purpose: Saves the phases as a Chrome trace (chrome://tracing or
+   *          Perfetto), one track per worker, times in microseconds from
+   *          the start of the run
+   * Inputs: Trace file:   filename
+   *         # of threads: numTids
+   * Returns: 0, or -1 if the file can't be opened
+   */
+  FILE *file = fopen(filename, "w");
+  int i, e, c, first = 1;
+  long dropped = 0;
+  if (file == NULL) {
+    return golFail(sim, "Unable to open trace file %s", filename);
+  }
+  fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  for (i = 0; i < numTids; i++) {
+    fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d,"
+            " \"args\": {\"name\": \"worker %d\"}}", first ? "" : ",\n", i, i);
+    first = 0;
+    for (e = 0; e < sim->profiles[i].numTrace; e++) {
+      struct traceEvent *event = &sim->profiles[i].trace[e];
+      fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d,"
+              " \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"gen\": %d", phaseNames[event->phase],
+              i, event->start*1e6, event->dur*1e6, event->gen);
+      for (c = 0; sim->hwCounters && !sim->countersWarned && c < NUM_COUNTERS; c++) {
+        fprintf(file, ", \"%s\": %llu", counterNames[c], (unsigned long long)event->counts[c]);
+      }
+      fprintf(file, "}}");
+    }
+    dropped += sim->profiles[i].dropped;
+  }
+  fprintf(file, "\n]}\n");
+  fclose(file);
+  if (dropped) {
+    printf("Trace kept the first %d events of each thread, %ld more dropped\n", TRACE_EVENTS,
+           dropped);
+  }
+  return 0;
+}
+
+static void freeProfiles(struct golSim *sim, int numTids) {
+  /*
+   * Purpose: Frees the profiles and their traces
+   * Inputs: # of threads: numTids
+   * Returns: Nothing
+   */
+  int i;
+  for (i = 0; i < numTids; i++) {
+    free(sim->profiles[i].trace);
+  }
+  free(sim->profiles);
+}
+
+static inline uint64_t westOf(const uint64_t *row, int w) {
+  /*
+   * Purpose: Lines up each cell's west neighbor (col-1) with the cell, pulling
+   *          the carry bit in from the previous word; at word 0 that is the
+   *          left halo word, whose top bit holds the wrapped last column
+   */
+  return (row[w] << 1) | (row[w-1] >> 63);
+}
+
+static inline uint64_t eastOf(const uint64_t *row, int w, int eastShift) {
+  /*
+   * Purpose: Lines up each cell's east neighbor (col+1) with the cell. The
+   *          next word's low bit lands in bit eastShift: 63 for full words,
+   *          the last used bit for a partial last word, whose next word is
+   *          the right halo holding the wrapped column 0
+   */
+  return (row[w] >> 1) | (row[w+1] << eastShift);
+}
+
+static inline void fullAdd(uint64_t a, uint64_t b, uint64_t c,
+                           uint64_t *sum, uint64_t *carry) {
+  // Adds three bits in each of the 64 lanes
+  uint64_t t = a ^ b;
+  *sum = t ^ c;
+  *carry = (a & b) | (t & c);
+}
+
+static inline __attribute__((always_inline))
+uint64_t evolveWord(const uint64_t *up, const uint64_t *mid, const uint64_t *down, int w,
+                    int eastShift, int birth, int survive) {
+  /*
+   * Purpose: Computes the next generation of the 64 cells in word w of a row
+   *          by summing the eight neighbor bitmaps with full adders, then
+   *          matching the sums against the rule. Inlined with a named rule's
+   *          constant masks, only the counts it names are matched
+   * Inputs: Rows above, at and below the cells: up, mid, down
+   *         Word index:                         w
+   *         Shift for the east carry:           eastShift (see eastOf)
+   *         Rule masks:                         birth, survive
+   * Returns: The next-generation word
+   */
+  uint64_t s0, c0, s1, c1, s2, c2, ones, c3, t, fours0, twos, fours1, fours, eights, eq;
+  uint64_t next = 0;
+  int n;
+
+  // Weight-1 sums of each row's neighbors, then of those sums
+  fullAdd(westOf(up,w), up[w], eastOf(up,w,eastShift), &s0, &c0);
+  fullAdd(westOf(down,w), down[w], eastOf(down,w,eastShift), &s1, &c1);
+  s2 = westOf(mid,w) ^ eastOf(mid,w,eastShift);
+  c2 = westOf(mid,w) & eastOf(mid,w,eastShift);
+  fullAdd(s0, s1, s2, &ones, &c3);
+
+  // Weight-2 carries; any weight-4 bit means the count is 4 or more
+  fullAdd(c0, c1, c2, &t, &fours0);
+  twos = t ^ c3;
+  fours1 = t & c3;
+
+  // Alive next if the count is 3, or 2 and the cell is already alive
+  if (birth == LIFE_BIRTH && survive == LIFE_SURVIVE) {
+    return twos & ~(fours0 | fours1) & (ones | mid[w]);
+  }
+
+  // Otherwise the count's bits are ones, twos, fours and eights; a count of
+  // 8 is the only one carrying twice into the fours
+  fours = fours0 ^ fours1;
+  eights = fours0 & fours1;
+#pragma GCC unroll 9
+  for (n = 0; n <= 8; n++) {
+    if (!((birth | survive) >> n & 1)) {
+      continue;
+    }
+    eq = ((n & 1) ? ones : ~ones) & ((n & 2) ? twos : ~twos) &
+         ((n & 4) ? fours : ~fours) & ((n & 8) ? eights : ~eights);
+    if (!(survive >> n & 1)) {
+      eq &= ~mid[w];
+    } else if (!(birth >> n & 1)) {
+      eq &= mid[w];
+    }
+    next |= eq;
+  }
+  return next;
+}
+
+static void refreshBitHalo(struct golSim *sim, uint64_t *board, int startRow, int endRow,
+                           int startW, int endW) {
+  /*
+   * Purpose: Bit-packed counterpart of refreshHalo. The owner of word 0 fills
+   *          the right halo word with it, and the owner of the last word
+   *          fills the left halo word so its top bit is column cols-1
+   * Inputs: Board:  board
+   *         Region: startRow..endRow, words startW..endW
+   * Returns: Nothing
+   */
+  int x, lastBit = (sim->cols-1) % 64;
+  if (sim->deadBoundary) {
+    return;
+  }
+  for (x = startRow; x <= endRow; x++) {
+    uint64_t *row = board + WORD(x,0);
+    if (startW == 0) {
+      row[sim->words] = row[0];
+    }
+    if (endW == sim->words-1) {
+      row[-1] = row[sim->words-1] << (63 - lastBit);
+    }
+  }
+  if (startRow == 0) {
+    memcpy(board + WORD(sim->rows,startW), board + WORD(0,startW),
+           (endW-startW+1)*sizeof(uint64_t));
+    if (startW == 0) {
+      board[WORD(sim->rows,sim->words)] = board[WORD(0,sim->words)];
+    }
+    if (endW == sim->words-1) {
+      board[WORD(sim->rows,-1)] = board[WORD(0,-1)];
+    }
+  }
+  if (endRow == sim->rows-1) {
+    memcpy(board + WORD(-1,startW), board + WORD(sim->rows-1,startW),
+           (endW-startW+1)*sizeof(uint64_t));
+    if (startW == 0) {
+      board[WORD(-1,sim->words)] = board[WORD(sim->rows-1,sim->words)];
+    }
+    if (endW == sim->words-1) {
+      board[WORD(-1,-1)] = board[WORD(sim->rows-1,-1)];
+    }
+  }
+}
+
+static inline __attribute__((always_inline))
+int evolveBitRule(struct golSim *sim, const uint64_t *ref, uint64_t *out, struct tile *t,
+                  int birth, int survive) {
+  /*
+   * Purpose: Evolves a bit-packed tile under a rule, for evolveBitTile to
+   *          inline once per named rule
+   * Inputs: Current and next boards: ref, out
+   *         Tile (columns in words): t
+   *         Rule masks:              birth, survive
+   * Returns: Nonzero if any cell of the tile changed
+   */
+  int lastBit = (sim->cols-1) % 64;
+  uint64_t lastMask = ~(uint64_t)0 >> (63 - lastBit);
+  int ownsLast = t->endCol == sim->words-1;
+  int endFull = ownsLast ? sim->words-2 : t->endCol;
+  uint64_t diff = 0;
+  int x, w;
+
+  for (x = t->startRow; x <= t->endRow; x++) {
+    const uint64_t *up = ref + WORD(x-1,0);
+    const uint64_t *mid = ref + WORD(x,0);
+    const uint64_t *down = ref + WORD(x+1,0);
+    uint64_t *row = out + WORD(x,0);
+    for (w = t->startCol; w <= endFull; w++) {
+      row[w] = evolveWord(up, mid, down, w, 63, birth, survive);
+      diff |= row[w] ^ mid[w];
+    }
+    if (ownsLast) {
+      row[sim->words-1] = evolveWord(up, mid, down, sim->words-1, lastBit, birth, survive) &
+                          lastMask;
+      diff |= row[sim->words-1] ^ mid[sim->words-1];
+    }
+  }
+  refreshBitHalo(sim, out, t->startRow, t->endRow, t->startCol, t->endCol);
+  return diff != 0;
+}
+
+static int evolveBitTile(struct golSim *sim, const uint64_t *ref, uint64_t *out, struct tile *t) {
+  /*
+   * Purpose: Bit-packed counterpart of evolveTile
+   * Inputs: Current and next boards: ref, out
+   *         Tile (columns in words): t
+   * Returns: Nonzero if any cell of the tile changed
+   */
+  switch (sim->ruleKind) {
+    case RULE_LIFE:
+      return evolveBitRule(sim, ref, out, t, LIFE_BIRTH, LIFE_SURVIVE);
+    case RULE_HIGHLIFE:
+      return evolveBitRule(sim, ref, out, t, HIGHLIFE_BIRTH, HIGHLIFE_SURVIVE);
+    case RULE_DAYNIGHT:
+      return evolveBitRule(sim, ref, out, t, DAYNIGHT_BIRTH, DAYNIGHT_SURVIVE);
+    case RULE_SEEDS:
+      return evolveBitRule(sim, ref, out, t, SEEDS_BIRTH, SEEDS_SURVIVE);
+    default:
+      return evolveBitRule(sim, ref, out, t, sim->birth, sim->survive);
+  }
+}
+
+static void finishGeneration(struct golSim *sim, int iter) {
+  /*
+   * Purpose: Publishes the generation the workers just finished and queues
+   *          frames and checkpoints. Runs on whichever worker the barrier
+   *          picks as its serial thread while the others move on: the board
+   *          it reads is not written again until the following barrier,
+   *          which this thread has yet to reach
+   * Inputs: Step just finished: iter (a superstep with haloDepth > 1)
+   * Returns: Nothing
+   */
+  int skipped = sim->skippedTiles[iter%2], i;
+  if (sim->hashing) {
+    for (i = 0; i < sim->threadCount; i++) {
+      sim->boardHash ^= sim->thread_args[i].hashDelta[iter%2];
+      sim->thread_args[i].hashDelta[iter%2] = 0;
+    }
+    // The workers see stopAt after the next barrier, so they run iter+2
+    // too, into the other board; runThreaded goes back to iter+1, the
+    // generation that repeats, and none after it may be planned for
+    if (!sim->cyclePeriod && noteGeneration(sim, sim->genBase+iter+1, sim->boardHash)) {
+      sim->ckptLast = (iter+1 < sim->ckptLast) ? iter+1 : sim->ckptLast;
+      sim->frameSteps = (iter+1 < sim->frameSteps) ? iter+1 : sim->frameSteps;
+      __atomic_store_n(&sim->stopAt, iter+2, __ATOMIC_RELAXED);
+    }
+  }
+  if (sim->ckptEvery) {
+    if (sim->ckptDue[iter%2]) {
+      handCheckpoint(sim, iter);
+    }
+    sim->ckptDue[iter%2] = planCheckpoint(sim, iter+2);
+  }
+  if (sim->frameFn) {
+    if (sim->frameDue[iter%2] >= 0) {
+      commitFrame(sim);
+    }
+    if (sim->frameDue[(iter+1)%2] >= 0) {
+      sim->frames[sim->frameDue[(iter+1)%2]].skipped = skipped;
+    }
+    sim->frameDue[iter%2] = planFrame(sim, iter+2);
+  }
+  sim->refBoard = sim->boards[(iter+1)%2];
+  sim->refBits = sim->bitBoards[(iter+1)%2];
+  sim->skippedTiles[iter%2] = 0;
+  sim->totalSkipped += skipped;
+}
+
+static inline size_t hlHash(struct node *nw, struct node *ne, struct node *sw, struct node *se) {
+  // Mixes the four child addresses into a bucket hash
+  uint64_t h = ((uintptr_t)nw + 3*(uintptr_t)ne + 5*(uintptr_t)sw + 7*(uintptr_t)se) *
+               0x9E3779B97F4A7C15ULL;
+  return (size_t)(h ^ (h >> 29));
+}
+
+static void hlInit(struct golSim *sim) {
+  /*
+   * Purpose: Sets up an empty node table
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  sim->hlTableSize = 1 << 16;
+  if (!(sim->hlTable = (struct node **)calloc(sim->hlTableSize, sizeof(struct node *)))) {
+    printf("malloc error\n");
+    exit(1);
+  }
+}
+
+static void hlFree(struct golSim *sim) {
+  /*
+   * Purpose: Releases every node along with the table and window memo,
+   *          leaving hashlife ready for hlInit again
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  int i;
+  for (i = 0; i < sim->hlNumBlocks; i++) {
+    free(sim->hlBlocks[i]);
+  }
+  free(sim->hlBlocks);
+  free(sim->hlTable);
+  free(sim->hlMemo);
+  sim->hlBlocks = NULL;
+  sim->hlNumBlocks = 0;
+  sim->hlTable = NULL;
+  sim->hlMemo = NULL;
+  sim->hlFreeList = NULL;
+  sim->hlNodes = 0;
+  sim->hlStep = -1;
+}
+
+static struct node *hlAlloc(struct golSim *sim) {
+  /*
+   * Purpose: Takes a node off the free list, carving a new block of them
+   *          when it runs dry
+   * Inputs: Nothing
+   * Returns: The node
+   */
+  struct node *n;
+  int i;
+  if (!sim->hlFreeList) {
+    struct node *block = (struct node *)malloc(sizeof(struct node)*HL_BLOCK);
+    sim->hlBlocks = (struct node **)realloc(sim->hlBlocks,
+                                            sizeof(struct node *)*(sim->hlNumBlocks+1));
+    if (!block || !sim->hlBlocks) {
+      printf("malloc error\n");
+      exit(1);
+    }
+    sim->hlBlocks[sim->hlNumBlocks++] = block;
+    for (i = 0; i < HL_BLOCK; i++) {
+      block[i].next = sim->hlFreeList;
+      sim->hlFreeList = &block[i];
+    }
+  }
+  n = sim->hlFreeList;
+  sim->hlFreeList = n->next;
+  return n;
+}
+
+static void hlGrow(struct golSim *sim) {
+  /*
+   * Purpose: Doubles the node table and rehashes its chains
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  size_t size = sim->hlTableSize*2, i, h;
+  struct node **table = (struct node **)calloc(size, sizeof(struct node *));
+  struct node *n, *next;
+  if (!table) {
+    printf("malloc error\n");
+    exit(1);
+  }
+  for (i = 0; i < sim->hlTableSize; i++) {
+    for (n = sim->hlTable[i]; n; n = next) {
+      next = n->next;
+      h = hlHash(n->nw, n->ne, n->sw, n->se) & (size-1);
+      n->next = table[h];
+      table[h] = n;
+    }
+  }
+  free(sim->hlTable);
+  sim->hlTable = table;
+  sim->hlTableSize = size;
+}
+
+static struct node *hlJoin(struct golSim *sim, struct node *nw, struct node *ne, struct node *sw,
+                           struct node *se) {
+  /*
+   * Purpose: Finds the canonical node with the given quadrants, making it
+   *          if this square has not been seen before
+   * Inputs: Quadrants, one level down: nw, ne, sw, se
+   * Returns: The node
+   */
+  size_t h = hlHash(nw, ne, sw, se) & (sim->hlTableSize-1);
+  struct node *n;
+  for (n = sim->hlTable[h]; n; n = n->next) {
+    if (n->nw == nw && n->ne == ne && n->sw == sw && n->se == se) {
+      return n;
+    }
+  }
+  n = hlAlloc(sim);
+  n->nw = nw;
+  n->ne = ne;
+  n->sw = sw;
+  n->se = se;
+  n->result = NULL;
+  n->level = nw->level+1;
+  n->alive = nw->alive | ne->alive | sw->alive | se->alive;
+  n->mark = 0;
+  n->next = sim->hlTable[h];
+  sim->hlTable[h] = n;
+  if (++sim->hlNodes > sim->hlTableSize) {
+    hlGrow(sim);
+  }
+  return n;
+}
+
+static void hlSetStep(struct golSim *sim, int step) {
+  /*
+   * Purpose: Makes results advance 2^step generations, dropping the results
+   *          memoized for any other step size
+   * Inputs: Log2 of the step: step
+   * Returns: Nothing
+   */
+  size_t i;
+  struct node *n;
+  if (step == sim->hlStep) {
+    return;
+  }
+  for (i = 0; i < sim->hlTableSize; i++) {
+    for (n = sim->hlTable[i]; n; n = n->next) {
+      n->result = NULL;
+    }
+  }
+  sim->hlStep = step;
+}
+
+static void hlMark(struct node *n) {
+  /*
+   * Purpose: Marks a node and everything it refers to as reachable
+   * Inputs: Node: n
+   * Returns: Nothing
+   */
+  if (n == NULL || n->level == 0 || n->mark) {
+    return;
+  }
+  n->mark = 1;
+  hlMark(n->nw);
+  hlMark(n->ne);
+  hlMark(n->sw);
+  hlMark(n->se);
+  hlMark(n->result);
+}
+
+static void hlCollect(struct golSim *sim, struct node *root) {
+  /*
+   * Purpose: Frees every node not reachable from root
+   * Inputs: Root node: root
+   * Returns: Nothing
+   */
+  size_t i;
+  struct node **link, *n;
+  hlMark(root);
+  for (i = 0; i < sim->hlTableSize; i++) {
+    link = &sim->hlTable[i];
+    while ((n = *link) != NULL) {
+      if (n->mark) {
+        n->mark = 0;
+        link = &n->next;
+      } else {
+        *link = n->next;
+        n->next = sim->hlFreeList;
+        sim->hlFreeList = n;
+        sim->hlNodes--;
+      }
+    }
+  }
+  sim->hlCollections++;
+}
+
+static inline struct node *hlCenter(struct golSim *sim, struct node *n) {
+  // The centre square of a node, one level down
+  return hlJoin(sim, n->nw->se, n->ne->sw, n->sw->ne, n->se->nw);
+}
+
+static struct node *hlLeafResult(struct golSim *sim, struct node *n) {
+  /*
+   * Purpose: Computes the result of a 4x4 node by applying the rules once
+   *          to its centre 2x2 cells
+   * Inputs: Level-2 node: n
+   * Returns: The level-1 result
+   */
+  struct node *quads[4] = {n->nw, n->ne, n->sw, n->se};
+  struct node *next[4];
+  int cells[4][4], x, y, dx, dy, neighbors;
+  for (x = 0; x < 4; x++) {
+    for (y = 0; y < 4; y++) {
+      struct node *q = quads[(x/2)*2 + y/2];
+      struct node *c = (x%2) ? ((y%2) ? q->se : q->sw) : ((y%2) ? q->ne : q->nw);
+      cells[x][y] = c->alive;
+    }
+  }
+  for (x = 1; x <= 2; x++) {
+    for (y = 1; y <= 2; y++) {
+      neighbors = -cells[x][y];
+      for (dx = -1; dx <= 1; dx++) {
+        for (dy = -1; dy <= 1; dy++) {
+          neighbors += cells[x+dx][y+dy];
+        }
+      }
+      next[(x-1)*2 + y-1] = (((cells[x][y] ? sim->survive : sim->birth) >> neighbors) & 1) ?
+                            &hlAlive : &hlDead;
+    }
+  }
+  return hlJoin(sim, next[0], next[1], next[2], next[3]);
+}
+
+static struct node *hlResult(struct golSim *sim, struct node *n) {
+  /*
+   * Purpose: Computes a node's RESULT. The nine overlapping squares one
+   *          level down are either advanced (at full speed) or just centred
+   *          (when the step is shorter), then regrouped into four squares
+   *          whose results tile the answer
+   * Inputs: Node of level 2 or more: n
+   * Returns: The result, one level down
+   */
+  struct node *sub[9], *r[9];
+  int i;
+  if (n->result) {
+    return n->result;
+  }
+  if (!n->alive) {
+    n->result = hlCenter(sim, n);
+    return n->result;
+  }
+  if (n->level == 2) {
+    n->result = hlLeafResult(sim, n);
+    return n->result;
+  }
+  sub[0] = n->nw;
+  sub[1] = hlJoin(sim, n->nw->ne, n->ne->nw, n->nw->se, n->ne->sw);
+  sub[2] = n->ne;
+  sub[3] = hlJoin(sim, n->nw->sw, n->nw->se, n->sw->nw, n->sw->ne);
+  sub[4] = hlCenter(sim, n);
+  sub[5] = hlJoin(sim, n->ne->sw, n->ne->se, n->se->nw, n->se->ne);
+  sub[6] = n->sw;
+  sub[7] = hlJoin(sim, n->sw->ne, n->se->nw, n->sw->se, n->se->sw);
+  sub[8] = n->se;
+  for (i = 0; i < 9; i++) {
+    r[i] = (sim->hlStep >= n->level-2) ? hlResult(sim, sub[i]) : hlCenter(sim, sub[i]);
+  }
+  n->result = hlJoin(sim, hlResult(sim, hlJoin(sim, r[0], r[1], r[3], r[4])),
+                     hlResult(sim, hlJoin(sim, r[1], r[2], r[4], r[5])),
+                     hlResult(sim, hlJoin(sim, r[3], r[4], r[6], r[7])),
+                     hlResult(sim, hlJoin(sim, r[4], r[5], r[7], r[8])));
+  return n->result;
+}
+
+static struct buildEntry *hlMemoSlot(struct golSim *sim, int level, long x, long y) {
+  /*
+   * Purpose: Finds the window memo slot for a square, empty if it has not
+   *          been built yet
+   * Inputs: Level and torus corner: level, x, y
+   * Returns: The slot
+   */
+  uint64_t h = ((uint64_t)x*0x9E3779B97F4A7C15ULL) ^ ((uint64_t)y*0xC2B2AE3D27D4EB4FULL) ^ level;
+  size_t i = (size_t)(h ^ (h >> 31)) & (sim->hlMemoSize-1);
+  while (sim->hlMemo[i].n && (sim->hlMemo[i].level != level || sim->hlMemo[i].x != x ||
+                              sim->hlMemo[i].y != y)) {
+    i = (i+1) & (sim->hlMemoSize-1);
+  }
+  return &sim->hlMemo[i];
+}
+
+static struct node *hlBuild(struct golSim *sim, int level, long x, long y) {
+  /*
+   * Purpose: Builds the square of the tiled plane whose corner is torus cell
+   *          (x, y). Squares repeat wherever the tiling does, so each
+   *          distinct (level, x, y) is built once
+   * Inputs: Level:       level
+   *         Corner cell: x (mod rows), y (mod cols)
+   * Returns: The node
+   */
+  struct buildEntry *e, *old;
+  struct node *n;
+  long half;
+  size_t i, size;
+  if (level == 0) {
+    return sim->boards[0][CELL(x,y)] == '@' ? &hlAlive : &hlDead;
+  }
+  if ((e = hlMemoSlot(sim, level, x, y))->n) {
+    return e->n;
+  }
+  half = 1L << (level-1);
+  n = hlJoin(sim, hlBuild(sim, level-1, x, y), hlBuild(sim, level-1, x, (y+half) % sim->cols),
+             hlBuild(sim, level-1, (x+half) % sim->rows, y),
+             hlBuild(sim, level-1, (x+half) % sim->rows, (y+half) % sim->cols));
+
+  // Keep the memo at most half full
+  if (2*(sim->hlMemoUsed+1) > sim->hlMemoSize) {
+    old = sim->hlMemo;
+    size = sim->hlMemoSize;
+    sim->hlMemoSize *= 2;
+    if (!(sim->hlMemo = (struct buildEntry *)calloc(sim->hlMemoSize, sizeof(struct buildEntry)))) {
+      printf("malloc error\n");
+      exit(1);
+    }
+    for (i = 0; i < size; i++) {
+      if (old[i].n) {
+        *hlMemoSlot(sim, old[i].level, old[i].x, old[i].y) = old[i];
+      }
+    }
+    free(old);
+  }
+  e = hlMemoSlot(sim, level, x, y);
+  e->n = n;
+  e->level = level;
+  e->x = x;
+  e->y = y;
+  sim->hlMemoUsed++;
+  return n;
+}
+
+static void hlExtract(struct golSim *sim, struct node *n, long x, long y, long shift) {
+  /*
+   * Purpose: Writes the live cells of a result back to the board. A result
+   *          square starts shift cells into its window on both axes, and is
+   *          at least as large as the board, so the part of it with
+   *          x < rows and y < cols covers every torus cell exactly once
+   * Inputs: Node and its corner within the result: n, x, y
+   *         Offset of the result within the window: shift
+   * Returns: Nothing
+   */
+  long half;
+  if (!n->alive || x >= sim->rows || y >= sim->cols) {
+    return;
+  }
+  if (n->level == 0) {
+    sim->boards[0][CELL((x+shift) % sim->rows, (y+shift) % sim->cols)] = '@';
+    return;
+  }
+  half = 1L << (n->level-1);
+  hlExtract(sim, n->nw, x, y, shift);
+  hlExtract(sim, n->ne, x, y+half, shift);
+  hlExtract(sim, n->sw, x+half, y, shift);
+  hlExtract(sim, n->se, x+half, y+half, shift);
+}
+
+static void runHashlife(struct golSim *sim, int iters) {
+  /*
+   * Purpose: Advances boards[0] by iters generations, 2^j at a time for
+   *          each bit j set in iters. Each jump builds a window of the
+   *          tiled plane large enough for its result to hold the whole board
+   *          and for the step to fit, then reads the board back out of the
+   *          result
+   * Inputs: Number of iterations: iters
+   * Returns: Nothing
+   */
+  int minLevel = 1, level, j;
+  struct node *window;
+
+  while ((1L << (minLevel-1)) < sim->rows || (1L << (minLevel-1)) < sim->cols) {
+    minLevel++;
+  }
+  hlInit(sim);
+  sim->hlMemoSize = 1 << 10;
+  for (j = 0; j < 31 && (iters >> j); j++) {
+    if (!((iters >> j) & 1)) {
+      continue;
+    }
+    level = (j+2 > minLevel) ? j+2 : minLevel;
+    hlSetStep(sim, j);
+    free(sim->hlMemo);
+    if (!(sim->hlMemo = (struct buildEntry *)calloc(sim->hlMemoSize, sizeof(struct buildEntry)))) {
+      printf("malloc error\n");
+      exit(1);
+    }
+    sim->hlMemoUsed = 0;
+    window = hlBuild(sim, level, 0, 0);
+    if (sim->hlNodes > HL_GC_NODES) {
+      hlCollect(sim, window);
+    }
+    window = hlResult(sim, window);
+    memset(sim->boards[0], '-', sim->boardBytes);
+    hlExtract(sim, window, 0, 0, 1L << (level-2));
+    refreshHalo(sim, sim->boards[0], 0, sim->rows-1, 0, sim->cols-1);
+  }
+}
+
+static void addLive(struct golSim *sim, uint64_t key) {
+  /*
+   * Purpose: Appends a cell to the sparse engine's live list, growing it as
+   *          needed
+   * Inputs: Cell, as x<<32 | y: key
+   * Returns: Nothing
+   */
+  if (sim->numLive == sim->liveCap) {
+    sim->liveCap = sim->liveCap ? 2*sim->liveCap : 1024;
+    if (!(sim->live = (uint64_t *)realloc(sim->live, sizeof(uint64_t)*sim->liveCap))) {
+      printf("malloc error\n");
+      exit(1);
+    }
+  }
+  sim->live[sim->numLive++] = key;
+}
+
+static int compareKeys(const void *a, const void *b) {
+  // Orders cell keys, which puts cells in row-major order
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+static void sortLive(struct golSim *sim) {
+  /*
+   * Purpose: Puts the live list in row-major order, for the calls that read
+   *          cells out, dropping any cell listed twice
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  long i, n = 0;
+  if (sim->liveSorted) {
+    return;
+  }
+  qsort(sim->live, sim->numLive, sizeof(uint64_t), compareKeys);
+  for (i = 0; i < sim->numLive; i++) {
+    if (!n || sim->live[i] != sim->live[n-1]) {
+      sim->live[n++] = sim->live[i];
+    }
+  }
+  sim->numLive = n;
+  sim->liveSorted = 1;
+}
+
+static inline void sparseAdd(struct golSim *sim, uint64_t key, int add) {
+  // Adds to a cell's slot in the sparse table, claiming one if it has none
+  uint64_t mix = key * 0x9E3779B97F4A7C15ULL;
+  size_t mask = sim->sparseSize-1, h = (size_t)(mix ^ (mix >> 32)) & mask;
+  while (sim->sparseKeys[h] != key) {
+    if (sim->sparseKeys[h] == SPARSE_EMPTY) {
+      sim->sparseKeys[h] = key;
+      break;
+    }
+    h = (h+1) & mask;
+  }
+  sim->sparseCounts[h] += add;
+}
+
+static void sparseStep(struct golSim *sim) {
+  /*
+   * Purpose: Runs one generation of the sparse engine: every live cell adds
+   *          one to each of its eight neighbors' slots and marks its own,
+   *          then the slots with three neighbors, or two and a live cell,
+   *          become the new live list. On a torus the neighbors wrap around,
+   *          so on a board one or two cells across a cell can be its own
+   *          neighbor, just as the dense engines' halos make it
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  size_t size = 1024, i;
+  long n, x, y, nx, ny;
+  int dx, dy;
+  unsigned char c;
+
+  // Keep the table at most half full: each live cell fills up to nine slots
+  while (size < 18*(size_t)sim->numLive) {
+    size *= 2;
+  }
+  if (size != sim->sparseSize) {
+    free(sim->sparseKeys);
+    free(sim->sparseCounts);
+    sim->sparseSize = size;
+    sim->sparseKeys = (uint64_t *)malloc(size*sizeof(uint64_t));
+    sim->sparseCounts = (unsigned char *)malloc(size);
+    if (!sim->sparseKeys || !sim->sparseCounts) {
+      printf("malloc error\n");
+      exit(1);
+    }
+  }
+  memset(sim->sparseKeys, 0xff, size*sizeof(uint64_t));
+  memset(sim->sparseCounts, 0, size);
+
+  for (n = 0; n < sim->numLive; n++) {
+    x = (long)(sim->live[n] >> 32);
+    y = (long)(sim->live[n] & 0xffffffff);
+    sparseAdd(sim, sim->live[n], SPARSE_ALIVE);
+    for (dx = -1; dx <= 1; dx++) {
+      nx = x+dx;
+      if (nx < 0 || nx >= sim->rows) {
+        if (sim->deadBoundary) {
+          continue;
+        }
+        nx = (nx + sim->rows) % sim->rows;
+      }
+      for (dy = -1; dy <= 1; dy++) {
+        ny = y+dy;
+        if (!dx && !dy) {
+          continue;
+        }
+        if (ny < 0 || ny >= sim->cols) {
+          if (sim->deadBoundary) {
+            continue;
+          }
+          ny = (ny + sim->cols) % sim->cols;
+        }
+        sparseAdd(sim, (uint64_t)nx << 32 | (uint64_t)ny, 1);
+      }
+    }
+  }
+
+  // The old list has been read, so the new one is written over it
+  sim->numLive = 0;
+  for (i = 0; i < size; i++) {
+    c = sim->sparseCounts[i];
+    if (sim->sparseKeys[i] != SPARSE_EMPTY &&
+        ((((c & SPARSE_ALIVE) ? sim->survive : sim->birth) >> (c & ~SPARSE_ALIVE)) & 1)) {
+      addLive(sim, sim->sparseKeys[i]);
+    }
+  }
+  sim->liveSorted = 0;
+  if (sim->numLive > sim->livePeak) {
+    sim->livePeak = sim->numLive;
+  }
+}
+
+static int runSparse(struct golSim *sim, int iters) {
+  /*
+   * Purpose: Advances the live list by iters generations, or until the
+   *          board repeats when hashing. An empty board stays empty, so
+   *          the rest of the step is skipped once it is
+   * Inputs: Number of iterations: iters
+   * Returns: The generations run, fewer than iters if a cycle stopped them
+   */
+  int i;
+  for (i = 0; i < iters && (sim->numLive || sim->hashing); i++) {
+    sparseStep(sim);
+    if (sim->hashing && !sim->cyclePeriod &&
+        noteGeneration(sim, sim->genBase+i+1, sim->boardHash = hashLive(sim))) {
+      return i+1;
+    }
+  }
+  return iters;
+}
+
+static void packLive(struct golSim *sim, uint64_t *dst, int startRow, int endRow) {
+  /*
+   * Purpose: Packs rows of the sparse engine's board into checkpoint
+   *          layout, for the calls that hand out a dense copy
+   * Inputs: Packed board: dst
+   *         Rows:         startRow..endRow
+   * Returns: Nothing
+   */
+  long lo = 0, hi, mid;
+  uint64_t first = (uint64_t)startRow << 32, x, y;
+  sortLive(sim);
+  memset(dst + (size_t)startRow*sim->words, 0,
+         (size_t)(endRow-startRow+1)*sim->words*sizeof(uint64_t));
+  // Find the first live cell at or after the start row
+  hi = sim->numLive;
+  while (lo < hi) {
+    mid = lo + (hi-lo)/2;
+    if (sim->live[mid] < first) {
+      lo = mid+1;
+    } else {
+      hi = mid;
+    }
+  }
+  for (; lo < sim->numLive && (long)(sim->live[lo] >> 32) <= endRow; lo++) {
+    x = sim->live[lo] >> 32;
+    y = sim->live[lo] & 0xffffffff;
+    dst[x*sim->words + y/64] |= (uint64_t)1 << (y%64);
+  }
+}
+
+static int openStream(struct golSim *sim) {
+  /*
+   * Purpose: Maps the stream engine's file, a header page and then both
+   *          generations, and gives each worker its padded rows. A new
+   *          file is left sparse so every cell starts dead. With
+   *          streamResume a file already there is mapped as it is and its
+   *          board carried on from, if it holds a finished generation of a
+   *          board this size; any other is refused rather than overwritten.
+   *          Without a file the boards are shared memory, which the shard
+   *          engine's shards write back to
+   * Inputs: Nothing
+   * Returns: 0, or -1 if the file can't be made, mapped or resumed
+   */
+  long page = sysconf(_SC_PAGESIZE);
+  size_t bytes = (size_t)sim->rows*sim->words*sizeof(uint64_t), total;
+  struct streamHeader *header;
+  struct stat st;
+  void *map;
+  int i;
+  sim->streamHead = page;
+  sim->streamHalf = (bytes + page-1) / page * page;
+  total = sim->streamHead + 2*sim->streamHalf;
+  if (!sim->streamFile) {
+    map = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+      return golFail(sim, "Unable to map %zu bytes of shared memory", total);
+    }
+  } else {
+    if (sim->streamResume && (sim->streamFd = open(sim->streamFile, O_RDWR)) >= 0) {
+      sim->streamResumed = 1;
+    } else if (sim->streamResume && errno != ENOENT) {
+      return golFail(sim, "Unable to open stream file %s", sim->streamFile);
+    } else if ((sim->streamFd = open(sim->streamFile, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0) {
+      return golFail(sim, "Unable to open stream file %s", sim->streamFile);
+    } else if (ftruncate(sim->streamFd, total) < 0) {
+      return golFail(sim, "Unable to grow stream file %s to %zu bytes", sim->streamFile, total);
+    }
+    if (sim->streamResumed && (fstat(sim->streamFd, &st) || (size_t)st.st_size != total)) {
+      return golFail(sim, "Unable to resume stream file %s, it doesn't hold a %d x %d board",
+                     sim->streamFile, sim->rows, sim->cols);
+    }
+    map = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, sim->streamFd, 0);
+    if (map == MAP_FAILED) {
+      return golFail(sim, "Unable to map stream file %s", sim->streamFile);
+    }
+  }
+  sim->streamMap = (uint64_t *)map;
+  header = (struct streamHeader *)map;
+  if (sim->streamResumed) {
+    if (memcmp(header->magic, STREAM_MAGIC, sizeof(header->magic)) ||
+        header->rows != sim->rows || header->cols != sim->cols || header->current < 0 ||
+        header->current > 1) {
+      return golFail(sim, "Unable to resume stream file %s, it doesn't hold a %d x %d board",
+                     sim->streamFile, sim->rows, sim->cols);
+    }
+    if (header->generation < 0) {
+      return golFail(sim, "Unable to resume stream file %s, a step was cut short writing it",
+                     sim->streamFile);
+    }
+    sim->generation = header->generation;
+  } else if (sim->streamFile) {
+    memcpy(header->magic, STREAM_MAGIC, sizeof(header->magic));
+    header->rows = sim->rows;
+    header->cols = sim->cols;
+    header->generation = -1;
+    header->current = 0;
+  }
+  i = sim->streamResumed ? header->current : 0;
+  sim->bitBoards[i] = sim->streamMap + sim->streamHead/sizeof(uint64_t);
+  sim->bitBoards[!i] = sim->bitBoards[i] + sim->streamHalf/sizeof(uint64_t);
+  sim->streamBand = (int)(STREAM_BAND_BYTES / ((long)sim->words*sizeof(uint64_t)));
+  if (sim->streamBand < 1) {
+    sim->streamBand = 1;
+  }
+  for (i = 0; i < sim->threadCount; i++) {
+    if (!(sim->thread_args[i].streamRows =
+          (uint64_t *)malloc(3*(sim->words+2)*sizeof(uint64_t)))) {
+      printf("malloc error\n");
+      exit(1);
+    }
+  }
+  return 0;
+}
+
+static void markStream(struct golSim *sim, long gen) {
+  /*
+   * Purpose: Records in the stream file's header the generation its current
+   *          board holds, or -1 while a step rewrites the boards. The
+   *          boards reach the disk before a generation is recorded, so the
+   *          header never names one that isn't there
+   * Inputs: Generation, or -1: gen
+   * Returns: Nothing
+   */
+  struct streamHeader *header = (struct streamHeader *)sim->streamMap;
+  uint64_t *first = sim->streamMap + sim->streamHead/sizeof(uint64_t);
+  if (!sim->streamFile) {
+    return;
+  }
+  if (gen >= 0) {
+    msync(first, 2*sim->streamHalf, MS_SYNC);
+  }
+  header->generation = gen;
+  header->current = sim->bitBoards[0] != first;
+  msync(header, sim->streamHead, MS_SYNC);
+}
+
+static void adviseRows(struct golSim *sim, uint64_t *board, int startRow, int endRow,
+                       int advice) {
+  /*
+   * Purpose: Passes madvise advice on rows of a stream board. Pages are
+   *          rounded out to read rows in, and in to drop them, so a page
+   *          half of some other row is never dropped
+   * Inputs: Board and rows: board, startRow..endRow
+   *         Advice:         advice, MADV_WILLNEED or MADV_DONTNEED
+   * Returns: Nothing
+   */
+  uintptr_t page = sysconf(_SC_PAGESIZE);
+  uintptr_t start = (uintptr_t)(board + (size_t)startRow*sim->words);
+  uintptr_t end = (uintptr_t)(board + (size_t)(endRow+1)*sim->words);
+  if (advice == MADV_DONTNEED) {
+    start = (start + page-1) & ~(page-1);
+    end &= ~(page-1);
+  } else {
+    start &= ~(page-1);
+    end = (end + page-1) & ~(page-1);
+  }
+  if (startRow <= endRow && start < end) {
+    madvise((void *)start, end-start, advice);
+  }
+}
+
+static void loadStreamRow(struct golSim *sim, uint64_t *dst, const uint64_t *board, int x) {
+  /*
+   * Purpose: Copies row x of a stream board between the halo words of one
+   *          of a worker's padded rows, so evolveWord can run on it. Past
+   *          a dead edge the row is all dead
+   * Inputs: Padded row, from its first word: dst
+   *         Board and row:                   board, x
+   * Returns: Nothing
+   */
+  if (x < 0 || x >= sim->rows) {
+    if (sim->deadBoundary) {
+      memset(dst-1, 0, (sim->words+2)*sizeof(uint64_t));
+      return;
+    }
+    x = (x + sim->rows) % sim->rows;
+  }
+  memcpy(dst, board + (size_t)x*sim->words, sim->words*sizeof(uint64_t));
+  if (sim->deadBoundary) {
+    dst[-1] = dst[sim->words] = 0;
+  } else {
+    dst[-1] = dst[sim->words-1] << (63 - (sim->cols-1) % 64);
+    dst[sim->words] = dst[0];
+  }
+}
+
+static inline __attribute__((always_inline))
+void streamRows(struct golSim *sim, struct tid_args *my_args, int birth, int survive) {
+  /*
+   * Purpose: Evolves a worker's share of the current band under a rule,
+   *          for streamBand to inline once per named rule. The three
+   *          padded rows turn over as it moves down, so each row of the
+   *          board is copied once
+   * Inputs: Argument struct: my_args
+   *         Rule masks:      birth, survive
+   * Returns: Nothing
+   */
+  const uint64_t *ref = sim->bitBoards[0];
+  uint64_t *next = sim->bitBoards[1], *out;
+  int rows = sim->streamEnd - sim->streamStart + 1, words = sim->words;
+  int first = sim->streamStart + (int)((long)rows*my_args->my_tid/sim->threadCount);
+  int last = sim->streamStart + (int)((long)rows*(my_args->my_tid+1)/sim->threadCount) - 1;
+  int lastBit = (sim->cols-1) % 64, x, w;
+  uint64_t lastMask = ~(uint64_t)0 >> (63 - lastBit);
+  const uint64_t *up, *mid, *down;
+#define STREAM_ROW(x) (my_args->streamRows + (size_t)(((x)+3) % 3)*(words+2) + 1)
+  if (first > last) {
+    return;
+  }
+  loadStreamRow(sim, STREAM_ROW(first-1), ref, first-1);
+  loadStreamRow(sim, STREAM_ROW(first), ref, first);
+  for (x = first; x <= last; x++) {
+    loadStreamRow(sim, STREAM_ROW(x+1), ref, x+1);
+    up = STREAM_ROW(x-1);
+    mid = STREAM_ROW(x);
+    down = STREAM_ROW(x+1);
+    out = next + (size_t)x*words;
+    for (w = 0; w < words-1; w++) {
+      out[w] = evolveWord(up, mid, down, w, 63, birth, survive);
+    }
+    out[words-1] = evolveWord(up, mid, down, words-1, lastBit, birth, survive) & lastMask;
+  }
+#undef STREAM_ROW
+}
+
+static void *streamBand(void *args) {
+  /*
+   * Purpose: Pool job evolving a worker's share of the current band
+   * Inputs: Argument struct: *args
+   * Returns: Nothing
+   */
+  struct tid_args *my_args = (struct tid_args *)args;
+  struct golSim *sim = my_args->sim;
+  switch (sim->ruleKind) {
+    case RULE_LIFE:
+      streamRows(sim, my_args, LIFE_BIRTH, LIFE_SURVIVE);
+      break;
+    case RULE_HIGHLIFE:
+      streamRows(sim, my_args, HIGHLIFE_BIRTH, HIGHLIFE_SURVIVE);
+      break;
+    case RULE_DAYNIGHT:
+      streamRows(sim, my_args, DAYNIGHT_BIRTH, DAYNIGHT_SURVIVE);
+      break;
+    case RULE_SEEDS:
+      streamRows(sim, my_args, SEEDS_BIRTH, SEEDS_SURVIVE);
+      break;
+    default:
+      streamRows(sim, my_args, sim->birth, sim->survive);
+  }
+  return NULL;
+}
+
+static void runStream(struct golSim *sim, int iters) {
+  /*
+   * Purpose: Advances the stream engine's board iters generations, a band
+   *          at a time. The kernel is asked to read the next band in while
+   *          the workers compute this one, a hint it may not have acted on
+   *          by the time the band is reached, and once a band is done its
+   *          output starts on its way to the file and the band before it
+   *          is dropped from both boards. Row 0 stays until the last band,
+   *          whose wrap reads it. The file's header says a step is under
+   *          way until the last generation is on disk
+   * Inputs: Number of iterations: iters
+   * Returns: Nothing
+   */
+  int i, b, bands = (sim->rows + sim->streamBand - 1) / sim->streamBand;
+  uint64_t *swap;
+  markStream(sim, -1);
+  for (i = 0; i < iters; i++) {
+    adviseRows(sim, sim->bitBoards[0], 0, sim->streamBand < sim->rows ? sim->streamBand-1 :
+               sim->rows-1, MADV_WILLNEED);
+    adviseRows(sim, sim->bitBoards[0], sim->rows-1, sim->rows-1, MADV_WILLNEED);
+    for (b = 0; b < bands; b++) {
+      sim->streamStart = b*sim->streamBand;
+      sim->streamEnd = (sim->streamStart+sim->streamBand < sim->rows) ?
+                       sim->streamStart+sim->streamBand-1 : sim->rows-1;
+      if (b+1 < bands) {
+        adviseRows(sim, sim->bitBoards[0], sim->streamEnd+1,
+                   (sim->streamEnd+sim->streamBand < sim->rows) ?
+                   sim->streamEnd+sim->streamBand : sim->rows-1, MADV_WILLNEED);
+      }
+      poolRun(sim, streamBand);
+      sync_file_range(sim->streamFd,
+                      (char *)(sim->bitBoards[1] + (size_t)sim->streamStart*sim->words) -
+                      (char *)sim->streamMap,
+                      (size_t)(sim->streamEnd-sim->streamStart+1)*sim->words*sizeof(uint64_t),
+                      SYNC_FILE_RANGE_WRITE);
+      if (b > 0) {
+        adviseRows(sim, sim->bitBoards[0], b == 1 ? 1 : (b-1)*sim->streamBand,
+                   sim->streamStart-1, MADV_DONTNEED);
+        adviseRows(sim, sim->bitBoards[1], (b-1)*sim->streamBand, sim->streamStart-1,
+                   MADV_DONTNEED);
+      }
+    }
+    adviseRows(sim, sim->bitBoards[0], 0, sim->rows-1, MADV_DONTNEED);
+    adviseRows(sim, sim->bitBoards[1], 0, sim->rows-1, MADV_DONTNEED);
+    swap = sim->bitBoards[0];
+    sim->bitBoards[0] = sim->bitBoards[1];
+    sim->bitBoards[1] = swap;
+  }
+  sim->refBits = sim->bitBoards[0];
+  markStream(sim, sim->generation + iters);
+}
+
+static int bandStart(struct golSim *sim, int shard) {
+  /*
+   * Purpose: Finds the first row of a shard's band; the bands split the
+   *          board's rows as evenly as they can
+   * Inputs: Shard: shard, up to shards for the row past the last band
+   * Returns: The row
+   */
+  return (int)((long)sim->rows*shard/sim->shards);
+}
+
+static int shuttle(struct transfer *t, int n, struct pollfd *fds, int *failed) {
+  /*
+   * Purpose: Carries out n transfers on non-blocking descriptors at once,
+   *          moving whichever poll says is ready, so two shards sending
+   *          each other rows larger than a socket's buffer never wait on
+   *          each other
+   * Inputs: Transfers:                   t, n
+   *         Room for n poll entries:     fds
+   *         Transfer that failed, if one did: *failed
+   * Returns: 0, or -1 if a descriptor closed or failed mid-transfer
+   */
+  struct transfer *x;
+  ssize_t moved;
+  int i, busy;
+  for (;;) {
+    for (i = busy = 0; i < n; i++) {
+      fds[i].fd = t[i].left ? t[i].fd : -1;
+      fds[i].events = t[i].out ? POLLOUT : POLLIN;
+      fds[i].revents = 0;
+      busy += t[i].left > 0;
+    }
+    if (!busy) {
+      return 0;
+    }
+    if (poll(fds, n, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      *failed = 0;
+      return -1;
+    }
+    for (i = 0; i < n; i++) {
+      if (fds[i].fd < 0 || !fds[i].revents) {
+        continue;
+      }
+      x = &t[i];
+      moved = x->out ? send(x->fd, x->buf, x->left, MSG_NOSIGNAL) :
+                       read(x->fd, x->buf, x->left);
+      if (moved < 0 && (errno == EAGAIN || errno == EINTR)) {
+        continue;
+      }
+      if (moved <= 0) {
+        *failed = i;
+        return -1;
+      }
+      x->buf += moved;
+      x->left -= moved;
+    }
+  }
+}
+
+static int shmOpen(struct golSim *sim) {
+  /*
+   * Purpose: Maps the shm transport's counters and mailboxes, and makes
+   *          each shard a pipe to the parent, which carries nothing: the
+   *          parent only watches for it to close
+   * Inputs: Nothing
+   * Returns: 0, or -1 if the memory or the pipes can't be had
+   */
+  size_t counters = sim->shards*sizeof(struct syncCounter);
+  void *map;
+  int s;
+  sim->shardShmBytes = counters + (size_t)sim->shards*4*sim->words*sizeof(uint64_t);
+  map = mmap(NULL, sim->shardShmBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+             -1, 0);
+  if (map == MAP_FAILED) {
+    return golFail(sim, "Unable to map %zu bytes for the shards' rows", sim->shardShmBytes);
+  }
+  sim->shardShm = map;
+  sim->shardCounters = (struct syncCounter *)map;
+  sim->shardMail = (uint64_t *)((char *)map + counters);
+  for (s = 0; s < sim->shards; s++) {
+    if (pipe(&sim->shardFds[4*s]) < 0) {
+      return golFail(sim, "Unable to make a pipe for shard %d", s);
+    }
+  }
+  sim->spinLimit = (long)sim->shards*sim->threadCount <= sysconf(_SC_NPROCESSORS_ONLN) ?
+                   SPIN_LIMIT : 0;
+  return 0;
+}
+
+static int shmExchange(struct golSim *sim, int gen, const uint64_t *first, const uint64_t *last,
+                       uint64_t *above, uint64_t *below) {
+  /*
+   * Purpose: Posts a shard's edge rows of generation gen to its mailboxes
+   *          and copies its neighbors' into its halo rows once they post
+   * Inputs: Generation:          gen
+   *         Rows to send:        first, last
+   *         Halo rows to fill:   above, below
+   * Returns: 0
+   */
+  size_t bytes = sim->words*sizeof(uint64_t);
+  int up = (sim->shard + sim->shards-1) % sim->shards, down = (sim->shard+1) % sim->shards;
+#define SHM_MAIL(s,which) (sim->shardMail + ((size_t)((s)*2 + gen%2)*2 + (which))*sim->words)
+  if (first) {
+    memcpy(SHM_MAIL(sim->shard, 0), first, bytes);
+  }
+  if (last) {
+    memcpy(SHM_MAIL(sim->shard, 1), last, bytes);
+  }
+  postCounter(&sim->shardCounters[sim->shard], gen, FUTEX_WAKE);
+  if (above) {
+    waitCounter(sim, &sim->shardCounters[up], gen, FUTEX_WAIT);
+    memcpy(above, SHM_MAIL(up, 1), bytes);
+  }
+  if (below) {
+    waitCounter(sim, &sim->shardCounters[down], gen, FUTEX_WAIT);
+    memcpy(below, SHM_MAIL(down, 0), bytes);
+  }
+#undef SHM_MAIL
+  return 0;
+}
+
+static int shmGather(struct golSim *sim, const uint64_t *band, int startRow, int rows) {
+  /*
+   * Purpose: Copies a shard's band straight into the parent's spare board,
+   *          which the shard shares
+   * Inputs: Band and where it goes: band, startRow, rows
+   * Returns: 0
+   */
+  memcpy(sim->shardOut + (size_t)startRow*sim->words, band,
+         (size_t)rows*sim->words*sizeof(uint64_t));
+  return 0;
+}
+
+static int shmCollect(struct golSim *sim) {
+  /*
+   * Purpose: Waits for every shard's pipe to close, reaping each shard as
+   *          it does; a shard that closed it and exited cleanly has
+   *          already written its band
+   * Inputs: Nothing
+   * Returns: 0, or -1 once a shard turns out to have failed
+   */
+  struct pollfd *fds;
+  int s, open = sim->shards;
+  ssize_t got;
+  char c;
+  if (!(fds = (struct pollfd *)malloc(sim->shards*sizeof(struct pollfd)))) {
+    printf("malloc error\n");
+    exit(1);
+  }
+  for (s = 0; s < sim->shards; s++) {
+    fds[s].fd = sim->shardFds[4*s];
+    fds[s].events = POLLIN;
+  }
+  while (open) {
+    if (poll(fds, sim->shards, -1) < 0 && errno != EINTR) {
+      free(fds);
+      return golFail(sim, "Unable to wait for the shards");
+    }
+    for (s = 0; s < sim->shards; s++) {
+      if (fds[s].fd < 0 || !fds[s].revents) {
+        continue;
+      }
+      got = read(fds[s].fd, &c, 1);
+      if (got > 0 || (got < 0 && (errno == EAGAIN || errno == EINTR))) {
+        continue;
+      }
+      fds[s].fd = -1;
+      open--;
+      reapShard(sim, s, 0, 0);
+      if (sim->lostRank) {
+        free(fds);
+        return -1;
+      }
+    }
+  }
+  free(fds);
+  return 0;
+}
+
+static void shmClose(struct golSim *sim) {
+  /*
+   * Purpose: Unmaps the shm transport's counters and mailboxes
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  if (sim->shardShm) {
+    munmap(sim->shardShm, sim->shardShmBytes);
+    sim->shardShm = NULL;
+  }
+}
+
+static int socketOpen(struct golSim *sim) {
+  /*
+   * Purpose: Makes the socket transport's Unix socket pairs: one from each
+   *          shard to the parent, and one between each pair of
+   *          neighboring shards, but across a dead edge
+   * Inputs: Nothing
+   * Returns: 0, or -1 if a pair can't be made
+   */
+  int s;
+  for (s = 0; s < sim->shards; s++) {
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, &sim->shardFds[4*s]) < 0 ||
+        ((!sim->deadBoundary || s < sim->shards-1) &&
+         socketpair(AF_UNIX, SOCK_STREAM, 0, &sim->shardFds[4*s+2]) < 0)) {
+      return golFail(sim, "Unable to make sockets for shard %d", s);
+    }
+  }
+  return 0;
+}
+
+static int socketExchange(struct golSim *sim, int gen, const uint64_t *first,
+                          const uint64_t *last, uint64_t *above, uint64_t *below) {
+  /*
+   * Purpose: Sends a shard's edge rows to its neighbors and reads theirs
+   *          into its halo rows, all at once. A stream socket keeps the
+   *          generations in order, so gen isn't needed
+   * Inputs: Generation:          gen
+   *         Rows to send:        first, last
+   *         Halo rows to fill:   above, below
+   * Returns: 0, or -1 if a neighbor is gone
+   */
+  struct transfer t[4];
+  struct pollfd fds[4];
+  size_t bytes = sim->words*sizeof(uint64_t);
+  int n = 0, failed;
+  (void)gen;
+  if (first) {
+    t[n++] = (struct transfer){sim->shardUp, (char *)first, bytes, 1};
+  }
+  if (last) {
+    t[n++] = (struct transfer){sim->shardDown, (char *)last, bytes, 1};
+  }
+  if (above) {
+    t[n++] = (struct transfer){sim->shardUp, (char *)above, bytes, 0};
+  }
+  if (below) {
+    t[n++] = (struct transfer){sim->shardDown, (char *)below, bytes, 0};
+  }
+  return shuttle(t, n, fds, &failed);
+}
+
+static int socketGather(struct golSim *sim, const uint64_t *band, int startRow, int rows) {
+  /*
+   * Purpose: Sends a shard's band to the parent
+   * Inputs: Band and where it goes: band, startRow, rows
+   * Returns: 0, or -1 if the parent is gone
+   */
+  struct transfer t = {sim->shardParent, (char *)band, (size_t)rows*sim->words*sizeof(uint64_t),
+                       1};
+  struct pollfd fd;
+  int failed;
+  (void)startRow;
+  return shuttle(&t, 1, &fd, &failed);
+}
+
+static int socketCollect(struct golSim *sim) {
+  /*
+   * Purpose: Reads every shard's band into the spare board, from all of
+   *          them at once
+   * Inputs: Nothing
+   * Returns: 0, or -1 if a shard's socket closed before its band was in
+   */
+  struct transfer *t;
+  struct pollfd *fds;
+  int s, failed, done;
+  if (!(t = (struct transfer *)malloc(sim->shards*sizeof(struct transfer))) ||
+      !(fds = (struct pollfd *)malloc(sim->shards*sizeof(struct pollfd)))) {
+    printf("malloc error\n");
+    exit(1);
+  }
+  for (s = 0; s < sim->shards; s++) {
+    t[s].fd = sim->shardFds[4*s];
+    t[s].buf = (char *)(sim->shardOut + (size_t)bandStart(sim, s)*sim->words);
+    t[s].left = (size_t)(bandStart(sim, s+1) - bandStart(sim, s))*sim->words*sizeof(uint64_t);
+    t[s].out = 0;
+  }
+  done = shuttle(t, sim->shards, fds, &failed);
+  if (done < 0) {
+    reapShard(sim, failed, 0, 0);
+  }
+  free(t);
+  free(fds);
+  return done;
+}
+
+static void keepShardFds(struct golSim *sim, int shard) {
+  /*
+   * Purpose: Closes the transport's descriptors that belong to other
+   *          processes, leaving them non-blocking for shuttle. A shard
+   *          keeps its end of its line to the parent and of its lines to
+   *          its neighbors; the parent keeps its ends of every shard's line
+   * Inputs: Shard, or -1 for the parent: shard
+   * Returns: Nothing
+   */
+  int up = (shard + sim->shards-1) % sim->shards, i, keep;
+  for (i = 0; i < 4*sim->shards; i++) {
+    keep = (shard < 0) ? i%4 == 0 : (i == 4*shard+1 || i == 4*shard+2 || i == 4*up+3);
+    if (sim->shardFds[i] >= 0 && !keep) {
+      close(sim->shardFds[i]);
+      sim->shardFds[i] = -1;
+    } else if (sim->shardFds[i] >= 0) {
+      fcntl(sim->shardFds[i], F_SETFL, fcntl(sim->shardFds[i], F_GETFL) | O_NONBLOCK);
+    }
+  }
+  if (shard >= 0) {
+    sim->shardParent = sim->shardFds[4*shard+1];
+    sim->shardDown = sim->shardFds[4*shard+2];
+    sim->shardUp = sim->shardFds[4*up+3];
+  }
+}
+
+static void closeShardFds(struct golSim *sim) {
+  /*
+   * Purpose: Closes whatever transport descriptors are still open
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  int i;
+  for (i = 0; i < 4*sim->shards; i++) {
+    if (sim->shardFds[i] >= 0) {
+      close(sim->shardFds[i]);
+      sim->shardFds[i] = -1;
+    }
+  }
+}
+
+static void reapShard(struct golSim *sim, int shard, int killed, int options) {
+  /*
+   * Purpose: Waits for a shard to end and, if it failed, keeps it as the
+   *          one to blame unless one already kept failed more plainly:
+   *          dying of a signal of its own outranks exiting with an error,
+   *          which outranks being killed by the parent after another
+   *          failed, which outranks exiting with SHARD_LOST_PEER as a
+   *          shard's neighbors do once it is gone. A shard dying of
+   *          SIGKILL may still be ending when its neighbors notice, so the
+   *          parent's SIGKILL can land on one already dying; ranking the
+   *          neighbors lowest keeps the blame on it even then
+   * Inputs: Shard: shard
+   *         Whether the parent killed it: killed
+   *         waitpid options: options, WNOHANG to reap it only if it has
+   *                          already ended
+   * Returns: Nothing
+   */
+  int status, rank;
+  pid_t pid;
+  if (!sim->shardPids[shard]) {
+    return;
+  }
+  while ((pid = waitpid(sim->shardPids[shard], &status, options)) < 0 && errno == EINTR) {
+  }
+  if (!pid) {
+    return;
+  }
+  sim->shardPids[shard] = 0;
+  if (WIFEXITED(status) && !WEXITSTATUS(status)) {
+    return;
+  }
+  if (WIFEXITED(status) && WEXITSTATUS(status) == SHARD_LOST_PEER) {
+    rank = 1;
+  } else if (killed && WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL) {
+    rank = 2;
+  } else {
+    rank = WIFSIGNALED(status) ? 4 : 3;
+  }
+  if (rank > sim->lostRank) {
+    sim->lostRank = rank;
+    sim->lostShard = shard;
+    sim->lostStatus = status;
+  }
+}
+
+static void runShard(struct golSim *sim, int steps) {
+  /*
+   * Purpose: Body of a forked shard: evolves its band steps generations,
+   *          trading edge rows with its neighbors after each, hands the
+   *          band back and exits. Only the forking thread survives a
+   *          fork, so the shard starts a pool of its own. The band is a
+   *          board of its own rows plus a halo row either side, run by
+   *          the stream engine's band kernel as one band
+   * Inputs: Number of iterations: steps
+   * Returns: Never
+   */
+  int first = bandStart(sim, sim->shard), rows = bandStart(sim, sim->shard+1) - first;
+  int top = sim->deadBoundary && sim->shard == 0;
+  int bottom = sim->deadBoundary && sim->shard == sim->shards-1;
+  size_t words = sim->words;
+  uint64_t *band[2], *swap;
+  int g, i, x;
+
+  prctl(PR_SET_PDEATHSIG, SIGKILL);
+  keepShardFds(sim, sim->shard);
+  pthread_mutex_init(&sim->poolLock, NULL);
+  pthread_cond_init(&sim->poolWake, NULL);
+  pthread_cond_init(&sim->poolIdle, NULL);
+  sim->poolJobId = sim->poolRunning = sim->poolQuit = 0;
+  poolStart(sim, sim->thread_args, sim->threadCount);
+  for (i = 0; i < 2; i++) {
+    if (!(band[i] = (uint64_t *)calloc((rows+2)*words, sizeof(uint64_t)))) {
+      printf("malloc error\n");
+      exit(1);
+    }
+  }
+  for (i = -1; i <= rows; i++) {
+    x = first+i;
+    if ((x < 0 || x >= sim->rows) && sim->deadBoundary) {
+      continue;
+    }
+    x = (x + sim->rows) % sim->rows;
+    memcpy(band[0] + (i+1)*words, sim->bitBoards[0] + (size_t)x*words, words*sizeof(uint64_t));
+  }
+
+  sim->rows = rows+2;
+  sim->streamStart = 1;
+  sim->streamEnd = rows;
+  for (g = 1; g <= steps; g++) {
+    sim->bitBoards[0] = band[0];
+    sim->bitBoards[1] = band[1];
+    poolRun(sim, streamBand);
+    if (sim->transport->exchange(sim, g, top ? NULL : band[1] + words,
+                                 bottom ? NULL : band[1] + rows*words, top ? NULL : band[1],
+                                 bottom ? NULL : band[1] + (rows+1)*words) < 0) {
+      _exit(SHARD_LOST_PEER);
+    }
+    swap = band[0];
+    band[0] = band[1];
+    band[1] = swap;
+  }
+  _exit(sim->transport->gather(sim, band[0] + words, first, rows) < 0);
+}
+
+static int runShards(struct golSim *sim, int steps) {
+  /*
+   * Purpose: Forks a shard per band to run steps generations and, once
+   *          every band is back in the spare board, makes it the current
+   *          one. Should a shard be lost the others are killed and the
+   *          board is left as it was
+   * Inputs: Number of iterations: steps
+   * Returns: steps, or -1 if the shards couldn't be started or one was
+   *          lost
+   */
+  uint64_t *swap;
+  int s, failed = 0, sig, ms;
+  pid_t pid;
+
+  if (!steps) {
+    return 0;
+  }
+  if (!(sim->shardFds = (int *)malloc(4*sim->shards*sizeof(int)))) {
+    printf("malloc error\n");
+    exit(1);
+  }
+  for (s = 0; s < 4*sim->shards; s++) {
+    sim->shardFds[s] = -1;
+  }
+  sim->lostRank = 0;
+  sim->shardOut = sim->bitBoards[1];
+  failed = sim->transport->open(sim) < 0;
+
+  // Buffered output would be written again by any shard that exits
+  fflush(NULL);
+  for (s = 0; s < sim->shards && !failed; s++) {
+    if ((pid = fork()) < 0) {
+      failed = 1;
+      golFail(sim, "Unable to fork shard %d of %d", s, sim->shards);
+    } else if (!pid) {
+      sim->shard = s;
+      runShard(sim, steps);
+    } else {
+      sim->shardPids[s] = pid;
+    }
+  }
+  keepShardFds(sim, -1);
+  if (!failed && sim->transport->collect(sim) < 0) {
+    failed = 1;
+  }
+  // Shards already gone ended on their own, however they went; only those
+  // still running are killed, and only their SIGKILL is the parent's. A
+  // shard's descriptors close a moment before it can be waited for, so its
+  // neighbors may be reaped while it can't yet be; until something other
+  // than them has been, the shards get a grace to end on their own
+  for (ms = 0; failed && ms <= SHARD_GRACE_MS; ms++) {
+    for (s = 0; s < sim->shards; s++) {
+      reapShard(sim, s, 0, WNOHANG);
+    }
+    if (sim->lostRank != 1) {
+      break;
+    }
+    usleep(1000);
+  }
+  for (s = 0; s < sim->shards; s++) {
+    if (failed && sim->shardPids[s]) {
+      kill(sim->shardPids[s], SIGKILL);
+    }
+    reapShard(sim, s, failed, 0);
+  }
+  closeShardFds(sim);
+  free(sim->shardFds);
+  sim->shardFds = NULL;
+  if (sim->transport->close) {
+    sim->transport->close(sim);
+  }
+
+  if (sim->lostRank) {
+    s = sim->lostShard;
+    if (WIFSIGNALED(sim->lostStatus)) {
+      sig = WTERMSIG(sim->lostStatus);
+      return golFail(sim, "Shard %d of %d, rows %d to %d, died of signal %d (%s); the board"
+                     " stays at generation %ld", s, sim->shards, bandStart(sim, s),
+                     bandStart(sim, s+1)-1, sig, strsignal(sig), sim->generation);
+    }
+    return golFail(sim, "Shard %d of %d, rows %d to %d, exited with status %d; the board stays"
+                   " at generation %ld", s, sim->shards, bandStart(sim, s), bandStart(sim, s+1)-1,
+                   WEXITSTATUS(sim->lostStatus), sim->generation);
+  }
+  if (failed) {
+    return -1;
+  }
+  swap = sim->bitBoards[0];
+  sim->bitBoards[0] = sim->bitBoards[1];
+  sim->bitBoards[1] = swap;
+  sim->refBits = sim->bitBoards[0];
+  return steps;
+}
+
+static int chooseEngine(struct golSim *sim) {
+  /*
+   * Purpose: Settles GOL_ENGINE_AUTO once the seed is read: the sparse
+   *          engine if the seed fills less than SPARSE_DENSITY of a board
+   *          of SPARSE_MIN_CELLS or more and nothing asked for needs the
+   *          workers or fills empty space (B0), else the char engine. Small
+   *          boards stay dense: they are cheap either way and keep their
+   *          partition reports
+   * Inputs: Nothing
+   * Returns: The engine
+   */
+  long cells = 0;
+  int c;
+  for (c = 0; c < sim->seed.numChunks; c++) {
+    cells += sim->seed.chunks[c].count;
+  }
+  if (sim->seed.format == SEED_NATIVE && cells > sim->seed.numCoords) {
+    cells = sim->seed.numCoords;
+  }
+  if ((long)sim->rows*sim->cols >= SPARSE_MIN_CELLS &&
+      cells < SPARSE_DENSITY*sim->rows*sim->cols && !sim->frameFn && !sim->ckptEvery &&
+      !sim->profiling && !sim->activeTiles && sim->haloDepth == 1 && !sim->syncNeighbors &&
+      !sim->workStealing && sim->numaMode == GOL_NUMA_NONE && !sim->hugePages &&
+      !(sim->birth & 1)) {
+    return GOL_ENGINE_SPARSE;
+  }
+  return GOL_ENGINE_CHAR;
+}
+
+static inline uint64_t splitmix64(uint64_t x) {
+  // Scrambles a cell's key into its Zobrist value
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+static uint64_t hashTile(struct golSim *sim, const char *board, const uint64_t *bits,
+                         struct tile *t) {
+  /*
+   * Purpose: Hashes one tile of a dense board. A char row is scanned eight
+   *          cells at a time: '@' has the 0x40 bit and '-' doesn't
+   * Inputs: Board, whichever the engine uses: board, bits
+   *         Tile:                             t
+   * Returns: The XOR of splitmix64 over the keys of the tile's live cells
+   */
+  uint64_t h = 0, word;
+  int x, y, w;
+  for (x = t->startRow; x <= t->endRow; x++) {
+    if (sim->engine == GOL_ENGINE_BIT) {
+      for (w = t->startCol; w <= t->endCol; w++) {
+        for (word = bits[WORD(x,w)]; word; word &= word-1) {
+          h ^= splitmix64((uint64_t)x << 32 | (uint64_t)(w*64 + __builtin_ctzll(word)));
+        }
+      }
+      continue;
+    }
+    const char *row = board + CELL(x,0);
+    for (y = t->startCol; y+8 <= t->endCol+1; y += 8) {
+      memcpy(&word, row+y, sizeof(word));
+      for (word &= 0x4040404040404040ULL; word; word &= word-1) {
+        h ^= splitmix64((uint64_t)x << 32 | (uint64_t)(y + __builtin_ctzll(word)/8));
+      }
+    }
+    for (; y <= t->endCol; y++) {
+      if (row[y] == '@') {
+        h ^= splitmix64((uint64_t)x << 32 | (uint64_t)y);
+      }
+    }
+  }
+  return h;
+}
+
+static void *hashTiles(void *args) {
+  /*
+   * Purpose: Pool job hashing a thread's own tiles of the reference board
+   *          from scratch, leaving their XOR in its hashDelta[0]
+   * Inputs: Argument struct: *args
+   * Returns: Nothing
+   */
+  struct tid_args *my_args = (struct tid_args *)args;
+  struct golSim *sim = my_args->sim;
+  int t;
+  for (t = my_args->firstTile; t < my_args->firstTile+my_args->numTiles; t++) {
+    sim->tileHash[t] = hashTile(sim, sim->refBoard, sim->refBits, &sim->tiles[t]);
+    my_args->hashDelta[0] ^= sim->tileHash[t];
+  }
+  return NULL;
+}
+
+static uint64_t hashLive(struct golSim *sim) {
+  /*
+   * Purpose: Hashes the sparse engine's board the way hashTile does a tile
+   * Inputs: Nothing
+   * Returns: The XOR of splitmix64 over the live cells' keys
+   */
+  uint64_t h = 0;
+  long i;
+  for (i = 0; i < sim->numLive; i++) {
+    h ^= splitmix64(sim->live[i]);
+  }
+  return h;
+}
+
+static void growHistory(struct golSim *sim) {
+  /*
+   * Purpose: Doubles the cycle history table and its ring, or makes their
+   *          first ones. The ring holds half as many hashes as the table
+   *          has slots, and is laid out oldest first again
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  struct historyEntry *old = sim->history;
+  uint64_t *oldRing = sim->historyRing;
+  size_t oldSize = sim->historySize, i, j;
+  sim->historySize = oldSize ? 2*oldSize : HISTORY_SLOTS;
+  if (!(sim->history = (struct historyEntry *)malloc(sim->historySize*sizeof(struct historyEntry))) ||
+      !(sim->historyRing = (uint64_t *)malloc(sim->historySize/2*sizeof(uint64_t)))) {
+    printf("malloc error\n");
+    exit(1);
+  }
+  for (i = 0; i < sim->historySize; i++) {
+    sim->history[i].gen = -1;
+  }
+  for (i = 0; i < oldSize; i++) {
+    if (old[i].gen < 0) {
+      continue;
+    }
+    for (j = old[i].hash & (sim->historySize-1); sim->history[j].gen >= 0;
+         j = (j+1) & (sim->historySize-1)) {
+    }
+    sim->history[j] = old[i];
+  }
+  for (i = 0; i < sim->historyUsed; i++) {
+    sim->historyRing[i] = oldRing[(sim->historyOldest+i) % (oldSize/2)];
+  }
+  sim->historyOldest = 0;
+  free(old);
+  free(oldRing);
+}
+
+static size_t findHistory(struct golSim *sim, uint64_t hash) {
+  /*
+   * Purpose: Finds a hash's slot in the cycle history table
+   * Inputs: Board hash: hash
+   * Returns: The slot holding hash, or the empty slot it would go in
+   */
+  size_t i;
+  for (i = hash & (sim->historySize-1); sim->history[i].gen >= 0 && sim->history[i].hash != hash;
+       i = (i+1) & (sim->historySize-1)) {
+  }
+  return i;
+}
+
+static void dropOldestHistory(struct golSim *sim) {
+  /*
+   * Purpose: Forgets the oldest generation in the cycle history. Entries
+   *          probed past its slot are shifted back into the gap, so every
+   *          entry stays reachable from its home slot without tombstones
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  size_t mask = sim->historySize-1, i, j, home;
+  i = findHistory(sim, sim->historyRing[sim->historyOldest]);
+  for (j = (i+1) & mask; sim->history[j].gen >= 0; j = (j+1) & mask) {
+    // An entry can fill the gap if its home slot isn't cyclically after
+    // the gap and at or before its own slot
+    home = sim->history[j].hash & mask;
+    if (((j-home) & mask) >= ((j-i) & mask)) {
+      sim->history[i] = sim->history[j];
+      i = j;
+    }
+  }
+  sim->history[i].gen = -1;
+  sim->historyOldest = (sim->historyOldest+1) % (sim->historySize/2);
+  sim->historyUsed--;
+}
+
+static int noteGeneration(struct golSim *sim, long gen, uint64_t hash) {
+  /*
+   * Purpose: Records a generation's board hash in the cycle history. If an
+   *          earlier generation still in the history had the same board,
+   *          the board has been in a cycle since that generation, and the
+   *          cycle is recorded instead. Once the history holds
+   *          HISTORY_WINDOW generations the oldest is forgotten, so a
+   *          longer period is never found. A false match on the 64-bit
+   *          hash is caught by skipCycle before anything is skipped
+   * Inputs: Generation and its board's hash: gen, hash
+   * Returns: 1 if this found the cycle, 0 otherwise
+   */
+  size_t i;
+  if (sim->historySize && sim->history[i = findHistory(sim, hash)].gen >= 0) {
+    // A step starts from the generation the last one ended on
+    if (sim->history[i].gen == gen) {
+      return 0;
+    }
+    sim->cycleStart = sim->history[i].gen;
+    sim->cyclePeriod = gen - sim->history[i].gen;
+    return 1;
+  }
+  if (sim->historyUsed == HISTORY_WINDOW) {
+    dropOldestHistory(sim);
+  }
+  if (2*(sim->historyUsed+1) > sim->historySize) {
+    growHistory(sim);
+  }
+  i = findHistory(sim, hash);
+  sim->history[i].hash = hash;
+  sim->history[i].gen = gen;
+  sim->historyRing[(sim->historyOldest+sim->historyUsed) % (sim->historySize/2)] = hash;
+  sim->historyUsed++;
+  return 0;
+}
+
+static void resetHistory(struct golSim *sim) {
+  /*
+   * Purpose: Forgets every generation seen and any cycle found, for a board
+   *          that has been replaced
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  size_t i;
+  for (i = 0; i < sim->historySize; i++) {
+    sim->history[i].gen = -1;
+  }
+  sim->historyUsed = 0;
+  sim->historyOldest = 0;
+  sim->cycleStart = -1;
+  sim->cyclePeriod = 0;
+  sim->cycleConfirmed = 0;
+}
+
+static int openSeed(struct golSim *sim, const char *filename) {
+  /*
+   * Purpose: Maps the seed file, works out its format and reads its header.
+   *          Native files give the board size and iterations; RLE gives the
+   *          pattern size; Life 1.06 and plaintext patterns are sized once
+   *          their cells are read. Only native files set seed.iters
+   * Inputs:  Input file: filename
+   * Returns: 0, or -1 if the file is missing or its header is bad
+   */
+  struct stat st;
+  const char *p, *end;
+  long header[4];
+  int fd = open(filename, O_RDONLY), i;
+
+  sim->seed.iters = -1;
+  if (fd < 0 || fstat(fd, &st) || st.st_size == 0) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    return golFail(sim, "Unable to load test parameters.\n"
+                   "Invalid test parameter file, must be a .txt file.");
+  }
+  sim->seed.size = st.st_size;
+  sim->seed.data = (char *)mmap(NULL, sim->seed.size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (sim->seed.data == MAP_FAILED) {
+    printf("mmap failed");
+    exit(1);
+  }
+  madvise(sim->seed.data, sim->seed.size, MADV_SEQUENTIAL);
+  p = sim->seed.data;
+  end = sim->seed.data + sim->seed.size;
+  while (p < end && isspace((unsigned char)*p)) {
+    p++;
+  }
+
+  if (end-p >= 10 && !strncmp(p, "#Life 1.06", 10)) {
+    sim->seed.format = SEED_LIFE106;
+    sim->seed.body = nextLine(p, end) - sim->seed.data;
+    return 0;
+  }
+  if (p < end && (*p == '!' || *p == '.' || *p == 'O' || *p == '*')) {
+    sim->seed.format = SEED_PLAINTEXT;
+    sim->seed.body = p - sim->seed.data;
+    return 0;
+  }
+  if (p < end && (*p == '#' || *p == 'x')) {
+    // RLE: comment lines, then "x = cols, y = rows[, rule = ...]"
+    while (p < end && *p == '#') {
+      p = nextLine(p, end);
+    }
+    sim->seed.format = SEED_RLE;
+    if (p >= end || *p != 'x' || !(p = memchr(p, '=', end-p)) ||
+        !(p = parseInt(p+1, end, &header[1])) || !(p = memchr(p, 'y', end-p)) ||
+        !(p = memchr(p, '=', end-p)) || !(p = parseInt(p+1, end, &header[0]))) {
+      return golFail(sim, "Invalid seed file, bad RLE header");
+    }
+    sim->seed.patRows = header[0];
+    sim->seed.patCols = header[1];
+    sim->seed.body = nextLine(p, end) - sim->seed.data;
+    return 0;
+  }
+
+  // Native: rows, cols, iterations, number of coordinates, then the pairs
+  sim->seed.format = SEED_NATIVE;
+  for (i = 0; i < 4; i++) {
+    if (!(p = parseInt(p, end, &header[i]))) {
+      return golFail(sim, "Invalid seed file, expected rows, cols, iterations and"
+                     " coordinates");
+    }
+  }
+  sim->seed.patRows = header[0];
+  sim->seed.patCols = header[1];
+  sim->seed.numCoords = header[3];
+  sim->seed.iters = header[2];
+  sim->seed.body = p - sim->seed.data;
+  return 0;
+}
+
+static const char *nextLine(const char *p, const char *end) {
+  /*
+   * Purpose: Finds the start of the line after the one p is in
+   * Inputs: Position and end of the text: p, end
+   * Returns: The next line, or end
+   */
+  const char *nl = memchr(p, '\n', end-p);
+  return nl ? nl+1 : end;
+}
+
+static const char *parseInt(const char *p, const char *end, long *value) {
+  /*
+   * Purpose: Reads an optionally signed integer after any blanks
+   * Inputs: Position and end of the text: p, end
+   *         Result:                       value
+   * Returns: The position after the number, or NULL if there is none
+   */
+  long v = 0;
+  int negative = 0;
+  while (p < end && isspace((unsigned char)*p)) {
+    p++;
+  }
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p++ == '-';
+  }
+  if (p == end || !isdigit((unsigned char)*p)) {
+    return NULL;
+  }
+  while (p < end && isdigit((unsigned char)*p)) {
+    v = v*10 + (*p++ - '0');
+  }
+  *value = negative ? -v : v;
+  return p;
+}
+
+static void addCell(struct golSim *sim, struct cellList *list, long x, long y) {
+  /*
+   * Purpose: Appends a live cell to a list, growing it as needed, or as the
+   *          seed's mode says only counts it or sets it in the packed board
+   * Inputs: List:             list
+   *         Row and column:   x, y
+   * Returns: Nothing
+   */
+  if (sim->seed.mode == SEED_PLACE) {
+    if (list->count++ >= list->limit) {
+      return;
+    }
+    x += sim->seed.offsetX;
+    y += sim->seed.offsetY;
+    if (x < 0 || x >= sim->rows || y < 0 || y >= sim->cols) {
+      if (!list->offBoard) {
+        list->offBoard = 1;
+        list->offX = x;
+        list->offY = y;
+      }
+      return;
+    }
+    // Chunks can share a word, so the bit goes in atomically
+    __atomic_fetch_or(&sim->bitBoards[0][(size_t)x*sim->words + y/64], (uint64_t)1 << (y%64),
+                      __ATOMIC_RELAXED);
+    return;
+  }
+  if (!list->count || x < list->minX) {
+    list->minX = x;
+  }
+  if (!list->count || x > list->maxX) {
+    list->maxX = x;
+  }
+  if (!list->count || y < list->minY) {
+    list->minY = y;
+  }
+  if (!list->count || y > list->maxY) {
+    list->maxY = y;
+  }
+  if (sim->seed.mode == SEED_MEASURE) {
+    list->count++;
+    return;
+  }
+  if (list->count == list->cap) {
+    list->cap = list->cap ? 2*list->cap : 1024;
+    list->xs = (long *)realloc(list->xs, sizeof(long)*list->cap);
+    list->ys = (long *)realloc(list->ys, sizeof(long)*list->cap);
+    if (!list->xs || !list->ys) {
+      printf("malloc error\n");
+      exit(1);
+    }
+  }
+  list->xs[list->count] = x;
+  list->ys[list->count++] = y;
+}
+
+static void *parseChunk(void *args) {
+  /*
+   * Purpose: Pool job reading one chunk of a seed's cells. Native and Life
+   *          1.06 files hold a pair per line, so the body is cut into one
+   *          chunk per thread and each thread takes the lines that start in
+   *          its chunk. A native file with some other layout is flagged and
+   *          read again whole by parseTokens. RLE and plaintext patterns are
+   *          read by thread 0 alone
+   * Inputs: Argument struct: *args
+   * Returns: Nothing
+   */
+  struct tid_args *my_args = (struct tid_args *)args;
+  struct golSim *sim = my_args->sim;
+  struct cellList *list;
+  const char *base = sim->seed.data + sim->seed.body, *end = sim->seed.data + sim->seed.size, *p, *stop, *q;
+  size_t len = end - base;
+  long a, b;
+  int tid = my_args->my_tid;
+
+  if (tid >= sim->seed.numChunks) {
+    return NULL;
+  }
+  list = &sim->seed.chunks[tid];
+  if (sim->seed.format == SEED_RLE) {
+    parseRLE(sim, list);
+    return NULL;
+  }
+  if (sim->seed.format == SEED_PLAINTEXT) {
+    parsePlaintext(sim, list);
+    return NULL;
+  }
+  p = base + len*tid/sim->seed.numChunks;
+  stop = base + len*(tid+1)/sim->seed.numChunks;
+  if (tid) {
+    while (p < end && p[-1] != '\n') {
+      p++;
+    }
+  }
+  for (; p < stop; p = nextLine(p, end)) {
+    q = p;
+    while (q < end && *q != '\n' && isspace((unsigned char)*q)) {
+      q++;
+    }
+    if (q == end || *q == '\n' || (sim->seed.format == SEED_LIFE106 && *q == '#')) {
+      continue;
+    }
+    if (!(q = parseInt(q, end, &a)) || *q == '\n' || !(q = parseInt(q, end, &b))) {
+      list->malformed = 1;
+      return NULL;
+    }
+    while (q < end && *q != '\n' && isspace((unsigned char)*q)) {
+      q++;
+    }
+    if (q < end && *q != '\n') {
+      list->malformed = 1;
+      return NULL;
+    }
+    // Life 1.06 lists x (column) before y (row)
+    if (sim->seed.format == SEED_LIFE106) {
+      addCell(sim, list, b, a);
+    } else {
+      addCell(sim, list, a, b);
+    }
+  }
+  return NULL;
+}
+
+static void parseTokens(struct golSim *sim, struct cellList *list) {
+  /*
+   * Purpose: Reads a native body as a plain stream of numbers, paired up in
+   *          order, the way fscanf would
+   * Inputs: List: list
+   * Returns: Nothing
+   */
+  const char *p = sim->seed.data + sim->seed.body, *end = sim->seed.data + sim->seed.size;
+  long a, b;
+  while (list->count < sim->seed.numCoords && (p = parseInt(p, end, &a)) &&
+         (p = parseInt(p, end, &b))) {
+    addCell(sim, list, a, b);
+  }
+}
+
+static void parseRLE(struct golSim *sim, struct cellList *list) {
+  /*
+   * Purpose: Reads an RLE body: runs of b (dead) and o (alive), each
+   *          optionally preceded by a count, $ to end a row, ! to finish.
+   *          Any letter other than b counts as alive
+   * Inputs: List: list
+   * Returns: Nothing
+   */
+  const char *p = sim->seed.data + sim->seed.body, *end = sim->seed.data + sim->seed.size;
+  long x = 0, y = 0, run = 0, count, i;
+  for (; p < end && *p != '!'; p++) {
+    if (isdigit((unsigned char)*p)) {
+      run = run*10 + (*p - '0');
+      continue;
+    }
+    if (isspace((unsigned char)*p)) {
+      continue;
+    }
+    count = run ? run : 1;
+    run = 0;
+    if (*p == '$') {
+      x += count;
+      y = 0;
+    } else if (*p == 'b' || *p == '.') {
+      y += count;
+    } else if (isalpha((unsigned char)*p)) {
+      for (i = 0; i < count; i++) {
+        addCell(sim, list, x, y++);
+      }
+    }
+  }
+}
+
+static void parsePlaintext(struct golSim *sim, struct cellList *list) {
+  /*
+   * Purpose: Reads a plaintext pattern: one row per line, O or * alive and
+   *          . dead, with lines starting in ! as comments. Also measures it
+   * Inputs: List: list
+   * Returns: Nothing
+   */
+  const char *p = sim->seed.data + sim->seed.body, *end = sim->seed.data + sim->seed.size, *line;
+  long x = 0, y;
+  for (line = p; line < end; line = nextLine(line, end)) {
+    if (*line == '!') {
+      continue;
+    }
+    for (y = 0, p = line; p < end && *p != '\n' && *p != '\r'; p++, y++) {
+      if (*p == 'O' || *p == '*') {
+        addCell(sim, list, x, y);
+      }
+    }
+    if (y > sim->seed.patCols) {
+      sim->seed.patCols = y;
+    }
+    x++;
+  }
+  sim->seed.patRows = x;
+}
+
+static int finishSeed(struct golSim *sim) {
+  /*
+   * Purpose: Settles the board size once the cells are read: the rows and
+   *          cols options if given, else the native header or the pattern's extent. A
+   *          pattern smaller than the board is centred on it, with Life 1.06
+   *          coordinates first shifted to start at 0
+   * Inputs: Nothing
+   * Returns: 0, or -1 if the cells are malformed or don't fit the board
+   */
+  long minX = LONG_MAX, minY = LONG_MAX, maxX = LONG_MIN, maxY = LONG_MIN;
+  long total = 0, rows, cols;
+  struct cellList *list;
+  int c, malformed = 0;
+
+  for (c = 0; c < sim->seed.numChunks; c++) {
+    malformed |= sim->seed.chunks[c].malformed;
+  }
+  if (malformed && sim->seed.format != SEED_NATIVE) {
+    return golFail(sim, "Invalid seed file, expected an x y pair per line");
+  }
+  if (malformed) {
+    for (c = 0; c < sim->seed.numChunks; c++) {
+      sim->seed.chunks[c].count = 0;
+    }
+    parseTokens(sim, &sim->seed.chunks[0]);
+  }
+  for (c = 0; c < sim->seed.numChunks; c++) {
+    total += sim->seed.chunks[c].count;
+  }
+  if (sim->seed.format == SEED_NATIVE && total < sim->seed.numCoords) {
+    return golFail(sim, "Invalid seed file, expected %ld coordinates but found %ld",
+                   sim->seed.numCoords, total);
+  }
+  if (sim->seed.format != SEED_NATIVE) {
+    sim->seed.numCoords = total;
+  }
+  if (sim->seed.format == SEED_LIFE106) {
+    for (c = 0; c < sim->seed.numChunks; c++) {
+      list = &sim->seed.chunks[c];
+      if (list->count) {
+        minX = list->minX < minX ? list->minX : minX;
+        maxX = list->maxX > maxX ? list->maxX : maxX;
+        minY = list->minY < minY ? list->minY : minY;
+        maxY = list->maxY > maxY ? list->maxY : maxY;
+      }
+    }
+    if (total) {
+      sim->seed.patRows = maxX-minX+1;
+      sim->seed.patCols = maxY-minY+1;
+      sim->seed.offsetX = -minX;
+      sim->seed.offsetY = -minY;
+    }
+  }
+
+  rows = sim->sizeRows ? sim->sizeRows : sim->seed.patRows;
+  cols = sim->sizeCols ? sim->sizeCols : sim->seed.patCols;
+  if (rows < 1 || cols < 1 || rows > MAX_SIDE || cols > MAX_SIDE) {
+    return golFail(sim, "Invalid seed file, the board is %ld x %ld, each side must be"
+                   " between 1 and %d", rows, cols, MAX_SIDE);
+  }
+  sim->rows = (int)rows;
+  sim->cols = (int)cols;
+  if (sim->seed.format != SEED_NATIVE) {
+    if (sim->seed.patRows > sim->rows || sim->seed.patCols > sim->cols) {
+      return golFail(sim, "Invalid size, the pattern needs %ld x %ld", sim->seed.patRows,
+                     sim->seed.patCols);
+    }
+    sim->seed.offsetX += (sim->rows - sim->seed.patRows)/2;
+    sim->seed.offsetY += (sim->cols - sim->seed.patCols)/2;
+  }
+  return 0;
+}
+
+static int placeSeed(struct golSim *sim) {
+  /*
+   * Purpose: Sets the seed's cells alive in the cleared boards, so both
+   *          buffers hold generation 0, or in the sparse engine's list. A
+   *          native file contributes its first numCoords pairs. The packed
+   *          engines' boards are placed in by placePacked instead
+   * Inputs: Nothing
+   * Returns: 0, or -1 if a cell is off the board
+   */
+  long i, x, y, placed = 0;
+  int c, p;
+  for (c = 0; c < sim->seed.numChunks; c++) {
+    for (i = 0; i < sim->seed.chunks[c].count; i++) {
+      if (sim->seed.format == SEED_NATIVE && placed == sim->seed.numCoords) {
+        break;
+      }
+      x = sim->seed.chunks[c].xs[i] + sim->seed.offsetX;
+      y = sim->seed.chunks[c].ys[i] + sim->seed.offsetY;
+      if (x < 0 || x >= sim->rows || y < 0 || y >= sim->cols) {
+        return golFail(sim, "Invalid seed file, cell %ld %ld is off the %d x %d board", x, y,
+                       sim->rows, sim->cols);
+      }
+      if (sim->engine == GOL_ENGINE_SPARSE) {
+        addLive(sim, (uint64_t)x << 32 | (uint64_t)y);
+        placed++;
+        continue;
+      }
+      for (p = 0; p < 2; p++) {
+        if (sim->engine == GOL_ENGINE_BIT) {
+          sim->bitBoards[p][WORD(x,y/64)] |= (uint64_t)1 << (y%64);
+        } else if (sim->boards[p]) {
+          sim->boards[p][CELL(x,y)] = '@';
+        }
+      }
+      placed++;
+    }
+  }
+  sim->seed.numCoords = placed;
+  if (sim->engine == GOL_ENGINE_SPARSE) {
+    sortLive(sim);
+    sim->livePeak = sim->numLive;
+    return 0;
+  }
+  for (p = 0; p < 2; p++) {
+    if (sim->engine == GOL_ENGINE_BIT) {
+      refreshBitHalo(sim, sim->bitBoards[p], 0, sim->rows-1, 0, sim->words-1);
+    } else if (sim->boards[p]) {
+      refreshHalo(sim, sim->boards[p], 0, sim->rows-1, 0, sim->cols-1);
+    }
+  }
+  return 0;
+}
+
+static int placePacked(struct golSim *sim) {
+  /*
+   * Purpose: Reads the seed's cells a second time, after SEED_MEASURE,
+   *          setting them straight in the packed engines' current board.
+   *          A native file contributes its first numCoords pairs, so each
+   *          chunk is let place what the chunks before it left of them
+   * Inputs: Nothing
+   * Returns: 0, or -1 if a cell is off the board
+   */
+  struct cellList *list;
+  long before = 0, placed = 0;
+  int c, malformed = 0;
+  for (c = 0; c < sim->seed.numChunks; c++) {
+    list = &sim->seed.chunks[c];
+    malformed |= list->malformed;
+    list->limit = LONG_MAX;
+    if (sim->seed.format == SEED_NATIVE) {
+      list->limit = (before < sim->seed.numCoords) ? sim->seed.numCoords-before : 0;
+    }
+    before += list->count;
+    list->count = 0;
+  }
+  sim->seed.mode = SEED_PLACE;
+  if (malformed) {
+    sim->seed.chunks[0].limit = sim->seed.numCoords;
+    parseTokens(sim, &sim->seed.chunks[0]);
+  } else {
+    poolRun(sim, parseChunk);
+  }
+  for (c = 0; c < sim->seed.numChunks; c++) {
+    list = &sim->seed.chunks[c];
+    if (list->offBoard) {
+      return golFail(sim, "Invalid seed file, cell %ld %ld is off the %d x %d board",
+                     list->offX, list->offY, sim->rows, sim->cols);
+    }
+    placed += (list->count < list->limit) ? list->count : list->limit;
+  }
+  sim->seed.numCoords = placed;
+  return 0;
+}
+
+static void freeSeed(struct golSim *sim) {
+  /*
+   * Purpose: Releases the seed's cell lists and unmaps its file
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  int c;
+  for (c = 0; sim->seed.chunks && c < sim->seed.numChunks; c++) {
+    free(sim->seed.chunks[c].xs);
+    free(sim->seed.chunks[c].ys);
+  }
+  free(sim->seed.chunks);
+  sim->seed.chunks = NULL;
+  if (sim->seed.data) {
+    munmap(sim->seed.data, sim->seed.size);
+  }
+  sim->seed.data = NULL;
+}
+
+static void partition(struct golSim *sim, struct tid_args *thread_args, int numTids,
+                      int partitionType){
+  /*
+   * Purpose: Partitions the board either row-wise or column-wise and assigns
+   *          partitions to threads.
+   * Inputs:  Arg struct:     *thread_args
+   *          # of threads:   numtids
+   *          Partition type: partitionType
+   * Returns: Nothing
+   * */
+  int partitions,remainder,i,currentRow,width;
+  if (partitionType == 2) {
+    tilePartition(sim, thread_args, numTids);
+    return;
+  }
+  currentRow = 0;
+  // The bit engine hands out whole words so no two threads share one
+  width = (sim->engine == GOL_ENGINE_BIT) ? sim->words : sim->cols;
+  partitions = sim->rows/numTids-1;
+  remainder = sim->rows % numTids;
+  if(!partitionType){
+    for(i=0;i<numTids;i++){
+      int startRow,endRow;
+	  startRow = currentRow;
+	  endRow = currentRow+partitions;
+	  if(remainder){
+	    endRow++;
+	    partitions++;
+  	    remainder--;
+  	  }
+  	  thread_args[i].my_tid = i;
+	  thread_args[i].startRow = startRow;
+	  thread_args[i].endRow = endRow;
+	  thread_args[i].startCol = 0;
+	  thread_args[i].endCol = width-1;
+	  currentRow+=partitions+1;
+	  partitions = sim->rows/numTids-1;
+    }
+  }else{    
+    partitions = width/numTids-1;
+    remainder = width % numTids;
+    int currentCol;
+    currentCol = 0;
+    for(i=0;i<numTids;i++){
+      int startCol,endCol;
+	  startCol = currentCol;
+	  endCol = currentCol+partitions;
+	  if(remainder){
+	    endCol++;
+	    partitions++;
+  	    remainder--;
+  	  }
+  	  thread_args[i].my_tid = i;
+	  thread_args[i].startRow = 0;
+	  thread_args[i].endRow = sim->rows-1;
+	  thread_args[i].startCol = startCol;
+	  thread_args[i].endCol = endCol;
+	  currentCol+=partitions+1;
+	  partitions = width/numTids-1;
+
+    }
+  }
+
+  // Each strip is a single tile. With more threads than rows or columns
+  // some strips are empty; they get no tile, so the tiles still form a
+  // tilesDown x tilesAcross grid of the board
+  if (!(sim->tiles = (struct tile *)malloc(sizeof(struct tile)*numTids))) {
+    printf("malloc error\n");
+    exit(1);
+  }
+  sim->totalTiles = 0;
+  for (i = 0; i < numTids; i++) {
+    thread_args[i].firstTile = sim->totalTiles;
+    thread_args[i].numTiles = 0;
+    if (thread_args[i].startRow > thread_args[i].endRow ||
+        thread_args[i].startCol > thread_args[i].endCol) {
+      continue;
+    }
+    sim->tiles[sim->totalTiles].startRow = thread_args[i].startRow;
+    sim->tiles[sim->totalTiles].endRow = thread_args[i].endRow;
+    sim->tiles[sim->totalTiles].startCol = thread_args[i].startCol;
+    sim->tiles[sim->totalTiles].endCol = thread_args[i].endCol;
+    thread_args[i].numTiles = 1;
+    sim->totalTiles++;
+  }
+  sim->tilesDown = partitionType ? 1 : sim->totalTiles;
+  sim->tilesAcross = partitionType ? sim->totalTiles : 1;
+}
+
+static long cacheSize(int level) {
+  /*
+   * Purpose: Looks up the size of the level 1 data cache or level 2 cache
+   * Inputs: Cache level: level
+   * Returns: Size in bytes, or a conservative guess if the system won't say
+   */
+  long size = -1;
+#if defined(_SC_LEVEL1_DCACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE)
+  size = sysconf(level == 1 ? _SC_LEVEL1_DCACHE_SIZE : _SC_LEVEL2_CACHE_SIZE);
+#endif
+  if (size <= 0) {
+    size = level == 1 ? 32*1024 : 1024*1024;
+  }
+  return size;
+}
+
+static void tilePartition(struct golSim *sim, struct tid_args *thread_args, int numTids){
+  /*
+   * Purpose: Cuts the board into 2D tiles and gives each thread a contiguous
+   *          run of them in row-major order. Unless tileRows and tileCols
+   *          set the shape, a tile row is as wide as a quarter of L1 (three input rows and
+   *          an output row then stay in L1 as the kernel moves down), and
+   *          the tile is as tall as keeps both boards' copies of it inside
+   *          half of L2
+   * Inputs:  Arg struct:     *thread_args
+   *          # of threads:   numTids
+   * Returns: Nothing
+   * */
+  int unitBytes = (sim->engine == GOL_ENGINE_BIT) ? sizeof(uint64_t) : 1;
+  int width = (sim->engine == GOL_ENGINE_BIT) ? sim->words : sim->cols;
+  int tileW, tileH, i, t;
+
+  if (sim->tileRows > 0) {
+    tileH = sim->tileRows;
+    tileW = (sim->engine == GOL_ENGINE_BIT) ? (sim->tileCols+63)/64 : sim->tileCols;
+  } else {
+    tileW = cacheSize(1) / (4*unitBytes);
+    if (sim->engine != GOL_ENGINE_BIT) {
+      tileW -= tileW % 64;
+    }
+    if (tileW < 1) {
+      tileW = 1;
+    }
+    if (tileW > width) {
+      tileW = width;
+    }
+    tileH = cacheSize(2) / (4*(long)tileW*unitBytes);
+    if (tileH < 1) {
+      tileH = 1;
+    }
+  }
+  if (tileW > width) {
+    tileW = width;
+  }
+  if (tileH > sim->rows) {
+    tileH = sim->rows;
+  }
+
+  // Tiles are counted in an int; tiny tiles on a huge board grow taller
+  sim->tilesAcross = (width+tileW-1)/tileW;
+  if ((long)(sim->rows+tileH-1)/tileH > INT_MAX/sim->tilesAcross) {
+    tileH = (sim->rows + INT_MAX/sim->tilesAcross - 1) / (INT_MAX/sim->tilesAcross);
+  }
+  sim->tilesDown = (sim->rows+tileH-1)/tileH;
+  sim->totalTiles = sim->tilesDown*sim->tilesAcross;
+  if (!(sim->tiles = (struct tile *)malloc(sizeof(struct tile)*sim->totalTiles))) {
+    printf("malloc error\n");
+    exit(1);
+  }
+  for (t = 0; t < sim->totalTiles; t++) {
+    sim->tiles[t].startRow = (t/sim->tilesAcross)*tileH;
+    sim->tiles[t].endRow = sim->tiles[t].startRow+tileH-1 < sim->rows-1 ?
+                           sim->tiles[t].startRow+tileH-1 : sim->rows-1;
+    sim->tiles[t].startCol = (t%sim->tilesAcross)*tileW;
+    sim->tiles[t].endCol = sim->tiles[t].startCol+tileW-1 < width-1 ?
+                           sim->tiles[t].startCol+tileW-1 : width-1;
+  }
+
+  // Spread the tiles as evenly as whole tiles allow
+  for (i = 0; i < numTids; i++) {
+    thread_args[i].my_tid = i;
+    thread_args[i].firstTile = (int)((long)sim->totalTiles*i/numTids);
+    thread_args[i].numTiles = (int)((long)sim->totalTiles*(i+1)/numTids) - thread_args[i].firstTile;
+    thread_args[i].startRow = sim->tiles[thread_args[i].firstTile].startRow;
+    thread_args[i].endRow = thread_args[i].numTiles ?
+      sim->tiles[thread_args[i].firstTile+thread_args[i].numTiles-1].endRow : -1;
+    thread_args[i].startCol = 0;
+    thread_args[i].endCol = width-1;
+  }
+}
+
+static void printPartitions(struct tid_args *thread_args, int tid, int willPrint){
+  /*
+   * Purpose: prints the partitions
+   * Inputs: Arg struct:      *thread_args
+   *         Thread ID:       tid
+   *         Print Condition: willPrint
+   *
+   * Returns: Nothing
+   * */
+  
+  if(!willPrint){
+    return;
+  }else{
+      struct tid_args current;
+      current = thread_args[tid];
+      int tid,startRow,endRow,rowPartSize,startCol,endCol,colPartSize;
+      tid = current.my_tid;
+      startRow = current.startRow;
+      endRow = current.endRow;
+      rowPartSize = current.endRow-current.startRow+1;
+      startCol = current.startCol;
+      endCol = current.endCol;
+      colPartSize = current.endCol-current.startCol+1;
+      printf("tid %d: rows: %d:%d (%d) cols: %d:%d (%d)\n",tid,startRow,endRow,rowPartSize,
+        startCol,endCol,colPartSize);
+    }
+  
+}
+
+static void printTiles(struct golSim *sim, struct tid_args *thread_args, int tid){
+  /*
+   * Purpose: printPartitions for tiled partitions: lists each tile a
+   *          thread owns, with columns given in cells for every engine
+   * Inputs: Arg struct:      *thread_args
+   *         Thread ID:       tid
+   *
+   * Returns: Nothing
+   * */
+  int t, unit = (sim->engine == GOL_ENGINE_BIT) ? 64 : 1;
+  printf("tid %d: tiles: %d:%d (%d)\n", thread_args[tid].my_tid, thread_args[tid].firstTile,
+         thread_args[tid].firstTile+thread_args[tid].numTiles-1, thread_args[tid].numTiles);
+  for (t = thread_args[tid].firstTile; t < thread_args[tid].firstTile+thread_args[tid].numTiles; t++) {
+    int startCol = sim->tiles[t].startCol*unit;
+    int endCol = (sim->tiles[t].endCol+1)*unit-1 < sim->cols-1 ?
+                 (sim->tiles[t].endCol+1)*unit-1 : sim->cols-1;
+    printf("  tile %d: rows: %d:%d (%d) cols: %d:%d (%d)\n", t, sim->tiles[t].startRow,
+           sim->tiles[t].endRow, sim->tiles[t].endRow-sim->tiles[t].startRow+1, startCol, endCol,
+           endCol-startCol+1);
+  }
+}
+
+static uint64_t fnv1a(const void *data, size_t bytes) {
+  /*
+   * Purpose: 64-bit FNV-1a hash, the checksum of a checkpoint's cells
+   * Inputs: Buffer and its length: data, bytes
+   * Returns: The hash
+   */
+  const unsigned char *p = (const unsigned char *)data;
+  uint64_t h = 0xcbf29ce484222325ULL;
+  size_t i;
+  for (i = 0; i < bytes; i++) {
+    h = (h ^ p[i]) * 0x100000001b3ULL;
+  }
+  return h;
+}
+
+static void packRow(struct golSim *sim, uint64_t *row, const char *board, const uint64_t *bits,
+                    int x) {
+  /*
+   * Purpose: Packs one row of a dense board, one bit per cell
+   * Inputs: Packed row:                         row
+   *         Board, whichever the engine uses:   board, bits
+   *         Row:                                x
+   * Returns: Nothing
+   */
+  int w, b, n;
+  if (sim->engine == GOL_ENGINE_BIT) {
+    memcpy(row, bits + WORD(x,0), sim->words*sizeof(uint64_t));
+    return;
+  }
+  if (PACKED(sim)) {
+    memcpy(row, bits + (size_t)x*sim->words, sim->words*sizeof(uint64_t));
+    return;
+  }
+  const char *cells = board + CELL(x,0);
+  for (w = 0; w < sim->words; w++) {
+    uint64_t word = 0;
+    n = (sim->cols - w*64 < 64) ? sim->cols - w*64 : 64;
+    for (b = 0; b < n; b++) {
+      word |= (uint64_t)(cells[w*64+b] == '@') << b;
+    }
+    row[w] = word;
+  }
+}
+
+static void packRows(struct golSim *sim, uint64_t *dst, const char *board, const uint64_t *bits,
+                     int startRow, int endRow) {
+  /*
+   * Purpose: Packs rows of a board into checkpoint layout, one bit per cell
+   * Inputs: Packed board:                       dst
+   *         Board, whichever the engine uses:   board, bits
+   *         Rows:                               startRow..endRow
+   * Returns: Nothing
+   */
+  int x;
+  if (sim->engine == GOL_ENGINE_SPARSE) {
+    packLive(sim, dst, startRow, endRow);
+    return;
+  }
+  for (x = startRow; x <= endRow; x++) {
+    packRow(sim, dst + (size_t)x*sim->words, board, bits, x);
+  }
+}
+
+static int writeCheckpoint(struct golSim *sim, const char *filename, const uint64_t *data,
+                           long gen, char *why) {
+  /*
+   * Purpose: Saves a packed board as a checkpoint file. It is written to
+   *          file.tmp and synced first, then renamed over the old one, so a
+   *          crash midway leaves the last complete checkpoint in place
+   * Inputs: Checkpoint file:              filename
+   *         Packed board:                 data
+   *         Generation:                   gen
+   *         Room for the failure, if any: why (ERROR_BYTES)
+   * Returns: 1 if the checkpoint was saved, 0 otherwise
+   */
+  struct checkpointHeader header;
+  size_t n = (size_t)sim->rows*sim->words;
+  char tmpFile[PATH_MAX];
+  FILE *file;
+
+  memcpy(header.magic, CKPT_MAGIC, sizeof(header.magic));
+  header.generation = gen;
+  header.rows = sim->rows;
+  header.cols = sim->cols;
+  header.checksum = fnv1a(data, n*sizeof(uint64_t));
+  if (snprintf(tmpFile, sizeof(tmpFile), "%s.tmp", filename) >= (int)sizeof(tmpFile)) {
+    return whyFailed(why, "Invalid checkpoint file %s, its name is too long", filename);
+  }
+  if (!(file = fopen(tmpFile, "wb"))) {
+    return whyFailed(why, "Unable to open checkpoint file %s", tmpFile);
+  }
+  if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+      fwrite(data, sizeof(uint64_t), n, file) != n ||
+      fflush(file) || fsync(fileno(file))) {
+    fclose(file);
+    unlink(tmpFile);
+    return whyFailed(why, "Unable to write checkpoint file %s", tmpFile);
+  }
+  fclose(file);
+  if (rename(tmpFile, filename)) {
+    return whyFailed(why, "Unable to rename %s to %s", tmpFile, filename);
+  }
+  return 1;
+}
+
+static int planCheckpoint(struct golSim *sim, int gen) {
+  /*
+   * Purpose: Decides whether generation gen gets checkpointed: it must be a
+   *          multiple of checkpointEvery short of the step's last
+   *          generation, which is left to golSave, and the writer must be
+   *          free. Runs on the barrier's serial thread
+   * Inputs: Generation, counted from genBase: gen
+   * Returns: 1 if the workers are to pack it, 0 otherwise
+   */
+  int due = 0;
+  if (!sim->ckptEvery || gen >= sim->ckptLast || (sim->genBase+gen) % sim->ckptEvery) {
+    return 0;
+  }
+  pthread_mutex_lock(&sim->ckptLock);
+  if (sim->ckptState == CKPT_IDLE) {
+    sim->ckptState = CKPT_PACKING;
+    due = 1;
+  } else {
+    sim->ckptSkipped++;
+  }
+  pthread_mutex_unlock(&sim->ckptLock);
+  return due;
+}
+
+static void handCheckpoint(struct golSim *sim, int gen) {
+  /*
+   * Purpose: Passes a snapshot the workers have finished packing to the
+   *          writer thread
+   * Inputs: Generation, counted from genBase: gen
+   * Returns: Nothing
+   */
+  pthread_mutex_lock(&sim->ckptLock);
+  sim->ckptGen = gen;
+  sim->ckptState = CKPT_WRITING;
+  pthread_cond_signal(&sim->ckptWake);
+  pthread_mutex_unlock(&sim->ckptLock);
+}
+
+static void *checkpointWriter(void *args) {
+  /*
+   * Purpose: Background thread that writes out each snapshot handed to it,
+   *          so the workers never wait on the disk. Nobody is waiting on
+   *          the result, so a failure is counted and kept for golFlush to
+   *          report
+   * Inputs: Simulation: args
+   * Returns: Nothing
+   */
+  struct golSim *sim = (struct golSim *)args;
+  char why[ERROR_BYTES];
+  int saved;
+  pthread_mutex_lock(&sim->ckptLock);
+  while (1) {
+    while (sim->ckptState != CKPT_WRITING && !sim->ckptQuit) {
+      pthread_cond_wait(&sim->ckptWake, &sim->ckptLock);
+    }
+    if (sim->ckptState != CKPT_WRITING) {
+      break;
+    }
+    pthread_mutex_unlock(&sim->ckptLock);
+    saved = writeCheckpoint(sim, sim->ckptFile, sim->ckptData, sim->genBase+sim->ckptGen, why);
+    pthread_mutex_lock(&sim->ckptLock);
+    if (!saved) {
+      sim->ckptFailed++;
+      memcpy(sim->ckptError, why, ERROR_BYTES);
+    }
+    sim->ckptWritten += saved;
+    sim->ckptState = CKPT_IDLE;
+    pthread_cond_broadcast(&sim->ckptIdle);
+  }
+  pthread_mutex_unlock(&sim->ckptLock);
+  return NULL;
+}
+
+static void startCheckpoints(struct golSim *sim) {
+  /*
+   * Purpose: Allocates the snapshot buffer and, for periodic checkpoints,
+   *          starts the writer thread
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  if (!(sim->ckptData = (uint64_t *)malloc((size_t)sim->rows*sim->words*sizeof(uint64_t)))) {
+    printf("malloc error\n");
+    exit(1);
+  }
+  if (sim->ckptEvery && pthread_create(&sim->ckptThread, NULL, checkpointWriter, sim)) {
+    perror("Checkpoint writer create error\n");
+    exit(1);
+  }
+  sim->ckptStarted = 1;
+}
+
+static void waitCheckpoint(struct golSim *sim) {
+  /*
+   * Purpose: Waits for the writer to finish the checkpoint in hand
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  pthread_mutex_lock(&sim->ckptLock);
+  while (sim->ckptState == CKPT_WRITING) {
+    pthread_cond_wait(&sim->ckptIdle, &sim->ckptLock);
+  }
+  pthread_mutex_unlock(&sim->ckptLock);
+}
+
+static void stopCheckpoints(struct golSim *sim) {
+  /*
+   * Purpose: Lets the writer finish the checkpoint in hand and stops it
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  if (sim->ckptEvery) {
+    waitCheckpoint(sim);
+    pthread_mutex_lock(&sim->ckptLock);
+    sim->ckptQuit = 1;
+    pthread_cond_signal(&sim->ckptWake);
+    pthread_mutex_unlock(&sim->ckptLock);
+    pthread_join(sim->ckptThread, NULL);
+  }
+  free(sim->ckptData);
+}
+
+static int planFrame(struct golSim *sim, int step) {
+  /*
+   * Purpose: Reserves a ring slot for the frame of a step's generation, if
+   *          frameEvery samples it. With the ring full the frame is dropped,
+   *          or with frameWait the caller waits for the writer. Runs on the
+   *          barrier's serial thread
+   * Inputs: Step, or superstep with haloDepth: step
+   * Returns: The slot the workers are to pack, or -1
+   */
+  long gen = (long)step*sim->haloDepth;
+  int slot;
+  if (gen >= sim->frameSteps || (sim->genBase+gen) % sim->frameEvery) {
+    return -1;
+  }
+  pthread_mutex_lock(&sim->frameLock);
+  while (sim->frameHead - sim->frameTail == FRAME_SLOTS) {
+    if (!sim->frameWait) {
+      sim->framesDropped++;
+      pthread_mutex_unlock(&sim->frameLock);
+      return -1;
+    }
+    pthread_cond_wait(&sim->frameFree, &sim->frameLock);
+  }
+  slot = sim->frameHead % FRAME_SLOTS;
+  sim->frameHead++;
+  sim->frames[slot].gen = sim->genBase+gen;
+  sim->frames[slot].skipped = -1;
+  pthread_mutex_unlock(&sim->frameLock);
+  return slot;
+}
+
+static void commitFrame(struct golSim *sim) {
+  /*
+   * Purpose: Passes the oldest reserved frame not yet committed, now packed,
+   *          to the writer. Frames are committed in the order their slots
+   *          were reserved, so the slot is always frameCommitted % FRAME_SLOTS
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  pthread_mutex_lock(&sim->frameLock);
+  sim->frameCommitted++;
+  pthread_cond_signal(&sim->frameWake);
+  pthread_mutex_unlock(&sim->frameLock);
+}
+
+static void pushFrame(struct golSim *sim, long gen) {
+  /*
+   * Purpose: Queues the reference board as a frame from the calling thread,
+   *          waiting for a slot whatever frameWait says. Used for a step's
+   *          last generation, which no step reads unless a cycle stopped
+   *          the step past it; then it is queued already and isn't again
+   * Inputs: Generation: gen
+   * Returns: Nothing
+   */
+  int slot;
+  pthread_mutex_lock(&sim->frameLock);
+  if (sim->frameHead && sim->frames[(sim->frameHead-1) % FRAME_SLOTS].gen == gen) {
+    pthread_mutex_unlock(&sim->frameLock);
+    return;
+  }
+  while (sim->frameHead - sim->frameTail == FRAME_SLOTS) {
+    pthread_cond_wait(&sim->frameFree, &sim->frameLock);
+  }
+  slot = sim->frameHead % FRAME_SLOTS;
+  sim->frameHead++;
+  pthread_mutex_unlock(&sim->frameLock);
+  sim->frames[slot].gen = gen;
+  sim->frames[slot].skipped = -1;
+  packRows(sim, sim->frames[slot].cells, sim->refBoard, sim->refBits, 0, sim->rows-1);
+  commitFrame(sim);
+}
+
+static void *frameWriter(void *args) {
+  /*
+   * Purpose: Background thread that hands committed frames to frameFn in
+   *          order
+   * Inputs: Simulation: args
+   * Returns: Nothing
+   */
+  struct golSim *sim = (struct golSim *)args;
+  struct golFrame view;
+  struct frame *f;
+
+  view.rows = sim->rows;
+  view.cols = sim->cols;
+  view.words = sim->words;
+  view.tiles = sim->totalTiles;
+  pthread_mutex_lock(&sim->frameLock);
+  while (1) {
+    while (sim->frameTail == sim->frameCommitted && !sim->frameQuit) {
+      pthread_cond_wait(&sim->frameWake, &sim->frameLock);
+    }
+    if (sim->frameTail == sim->frameCommitted) {
+      break;
+    }
+    f = &sim->frames[sim->frameTail % FRAME_SLOTS];
+    pthread_mutex_unlock(&sim->frameLock);
+    view.gen = f->gen;
+    view.cells = f->cells;
+    view.skipped = f->skipped;
+    sim->frameFn(sim->frameArg, &view);
+    pthread_mutex_lock(&sim->frameLock);
+    sim->frameTail++;
+    sim->framesShown++;
+    pthread_cond_broadcast(&sim->frameFree);
+  }
+  pthread_mutex_unlock(&sim->frameLock);
+  return NULL;
+}
+
+static void startFrames(struct golSim *sim) {
+  /*
+   * Purpose: Allocates the frame ring and starts the frame writer
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  int s;
+  for (s = 0; s < FRAME_SLOTS; s++) {
+    if (!(sim->frames[s].cells = (uint64_t *)malloc((size_t)sim->rows*sim->words*sizeof(uint64_t)))) {
+      printf("malloc error\n");
+      exit(1);
+    }
+  }
+  if (pthread_create(&sim->frameThread, NULL, frameWriter, sim)) {
+    perror("Frame writer create error\n");
+    exit(1);
+  }
+  sim->framesStarted = 1;
+}
+
+static void waitFrames(struct golSim *sim) {
+  /*
+   * Purpose: Waits for the frame writer to drain the ring
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  pthread_mutex_lock(&sim->frameLock);
+  while (sim->frameTail != sim->frameHead) {
+    pthread_cond_wait(&sim->frameFree, &sim->frameLock);
+  }
+  pthread_mutex_unlock(&sim->frameLock);
+}
+
+static void stopFrames(struct golSim *sim) {
+  /*
+   * Purpose: Waits for the frame writer to drain the ring, then stops it
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  int s;
+  pthread_mutex_lock(&sim->frameLock);
+  sim->frameQuit = 1;
+  pthread_cond_signal(&sim->frameWake);
+  pthread_mutex_unlock(&sim->frameLock);
+  pthread_join(sim->frameThread, NULL);
+  for (s = 0; s < FRAME_SLOTS; s++) {
+    free(sim->frames[s].cells);
+  }
+}
+
+static int checkLoaded(struct golSim *sim) {
+  /*
+   * Purpose: Guards the calls that need a board
+   * Inputs: Nothing
+   * Returns: 0, or -1 if the simulation is unusable or has no board yet
+   */
+  if (sim->broken) {
+    return -1;
+  }
+  if (!sim->loaded) {
+    return golFail(sim, "No board loaded, call golLoad first");
+  }
+  return 0;
+}
+
+static int loadFailed(struct golSim *sim) {
+  /*
+   * Purpose: Gives up on a load partway through. The boards may be half
+   *          built, so the simulation is no use for anything but golDestroy
+   * Inputs: Nothing
+   * Returns: -1
+   */
+  freeSeed(sim);
+  sim->broken = 1;
+  return -1;
+}
+
+static int parseRule(const char *rule, int *birth, int *survive) {
+  /*
+   * Purpose: Reads a rule string, B then the neighbor counts that bring a
+   *          cell to life, a slash, S then those that keep one alive, as in
+   *          B3/S23. Either letter may be lower case
+   * Inputs: Rule string: rule
+   *         Masks to fill: *birth, *survive
+   * Returns: 0, or -1 if the string is not a rule
+   */
+  int *mask = birth;
+  *birth = *survive = 0;
+  if (toupper((unsigned char)*rule++) != 'B') {
+    return -1;
+  }
+  for (; *rule && *rule != '/'; rule++) {
+    if (*rule < '0' || *rule > '8') {
+      return -1;
+    }
+    *mask |= 1 << (*rule - '0');
+  }
+  if (*rule++ != '/' || toupper((unsigned char)*rule++) != 'S') {
+    return -1;
+  }
+  for (mask = survive; *rule; rule++) {
+    if (*rule < '0' || *rule > '8') {
+      return -1;
+    }
+    *mask |= 1 << (*rule - '0');
+  }
+  return 0;
+}
+
+static int ruleKind(int birth, int survive) {
+  /*
+   * Purpose: Finds which kernels run a rule
+   * Inputs: Rule masks: birth, survive
+   * Returns: RULE_TABLE, or the RULE_* of a rule with kernels of its own
+   */
+  if (birth == LIFE_BIRTH && survive == LIFE_SURVIVE) {
+    return RULE_LIFE;
+  }
+  if (birth == HIGHLIFE_BIRTH && survive == HIGHLIFE_SURVIVE) {
+    return RULE_HIGHLIFE;
+  }
+  if (birth == DAYNIGHT_BIRTH && survive == DAYNIGHT_SURVIVE) {
+    return RULE_DAYNIGHT;
+  }
+  if (birth == SEEDS_BIRTH && survive == SEEDS_SURVIVE) {
+    return RULE_SEEDS;
+  }
+  return RULE_TABLE;
+}
+
+void golDefaults(struct golOptions *opts) {
+  /*
+   * Purpose: Fills in the options of a plain run: Conway's rule on the char
+   *          engine, or the sparse one for a nearly empty board, on one
+   *          thread over row strips of a torus, every frame, nothing else
+   * Inputs: Options: opts
+   * Returns: Nothing
+   */
+  memset(opts, 0, sizeof(*opts));
+  opts->engine = GOL_ENGINE_AUTO;
+  opts->threads = 1;
+  opts->simd = "auto";
+  opts->rule = "B3/S23";
+  opts->haloDepth = 1;
+  opts->numaMode = GOL_NUMA_NONE;
+  opts->frameEvery = 1;
+  opts->shards = 2;
+  opts->transport = "shm";
+}
+
+static const struct transport *findTransport(const char *name) {
+  /*
+   * Purpose: Looks up one of the shard engine's transports
+   * Inputs: Name: name
+   * Returns: The transport, or NULL if there is none by that name
+   */
+  int i;
+  for (i = 0; name && i < NUM_TRANSPORTS; i++) {
+    if (!strcmp(transports[i].name, name)) {
+      return &transports[i];
+    }
+  }
+  return NULL;
+}
+
+static const char *checkOptions(const struct golOptions *opts) {
+  /*
+   * Purpose: Vets a set of options, alone and in combination
+   * Inputs: Options: opts
+   * Returns: Why the options don't work, or NULL if they do
+   */
+  int birth, survive;
+  if (opts->engine < GOL_ENGINE_CHAR || opts->engine > GOL_ENGINE_SHARD) {
+    return "Invalid engine, must be char, bit, hashlife, sparse, stream, shard or auto";
+  }
+  if (opts->engine == GOL_ENGINE_STREAM && !opts->streamFile) {
+    return "Invalid engine, the stream engine needs a stream file for its boards";
+  }
+  if ((opts->engine == GOL_ENGINE_STREAM || opts->engine == GOL_ENGINE_SHARD) &&
+      (opts->activeTiles || opts->haloDepth > 1 || opts->syncNeighbors || opts->workStealing ||
+       opts->numaMode != GOL_NUMA_NONE || opts->hugePages || opts->checkpointEvery ||
+       opts->frameFn || opts->profiling || opts->hwCounters || opts->trace || opts->cycles)) {
+    return "Invalid engine, the stream and shard engines only run whole generations band"
+           " by band, without tiles, frames, periodic checkpoints, profiles or cycles";
+  }
+  if (opts->engine == GOL_ENGINE_SHARD && (opts->shards < 2 || opts->shards > 1000)) {
+    return "Invalid shards, must be an integer from 2 to 1000";
+  }
+  if (opts->engine == GOL_ENGINE_SHARD && !findTransport(opts->transport)) {
+    return "Invalid transport, must be shm or socket";
+  }
+  if (opts->rule && parseRule(opts->rule, &birth, &survive) < 0) {
+    return "Invalid rule, must be B and the birth counts, then S and the survival counts,"
+           " such as B36/S23";
+  }
+  if (opts->rule && (birth & 1) && (opts->engine == GOL_ENGINE_HASHLIFE ||
+                                    opts->engine == GOL_ENGINE_SPARSE)) {
+    return "Invalid rule, B0 brings empty space to life, which the hashlife and sparse"
+           " engines never visit";
+  }
+  if (opts->threads < 1 || opts->threads > 1000) {
+    return "Invalid threads, must be a positive integer < 1000";
+  }
+  if (opts->partition < 0 || opts->partition > 2) {
+    return "Invalid partition, must be 0 (rows), 1 (columns) or 2 (tiles)";
+  }
+  if (opts->tileRows < 0 || opts->tileCols < 0 || opts->rows < 0 || opts->cols < 0) {
+    return "Invalid size, tile and board sizes can't be negative";
+  }
+  if (opts->haloDepth < 1) {
+    return "Invalid halo-depth, must be a positive integer";
+  }
+  if (opts->frameEvery < 1) {
+    return "Invalid frame-every, must be a positive integer";
+  }
+  if (opts->checkpointEvery < 0) {
+    return "Invalid checkpoint-every, must be a positive integer";
+  }
+  if (opts->profiling && (opts->engine == GOL_ENGINE_HASHLIFE ||
+                          opts->engine == GOL_ENGINE_SPARSE)) {
+    return "Invalid profile, the hashlife and sparse engines run outside the worker threads";
+  }
+  if (opts->checkpointEvery && !opts->checkpointFile) {
+    return "Invalid checkpoint, periodic checkpoints need a checkpoint file";
+  }
+  if (opts->checkpointEvery && (opts->engine == GOL_ENGINE_HASHLIFE ||
+                                opts->engine == GOL_ENGINE_SPARSE || opts->haloDepth > 1 ||
+                                opts->syncNeighbors)) {
+    return "Invalid checkpoint-every, checkpoints are taken at the barrier between"
+           " single generations";
+  }
+  if (opts->engine == GOL_ENGINE_HASHLIFE && opts->deadBoundary) {
+    return "Invalid boundary, the hashlife engine only runs on a torus";
+  }
+  if (opts->haloDepth > 1 && opts->engine != GOL_ENGINE_CHAR &&
+      opts->engine != GOL_ENGINE_AUTO) {
+    return "Invalid halo-depth, only the char engine supports it";
+  }
+  if (opts->haloDepth > 1 && opts->activeTiles) {
+    return "Invalid halo-depth, active tiles need every generation's change bits";
+  }
+  if (opts->syncNeighbors && (opts->workStealing || opts->haloDepth > 1)) {
+    return "Invalid sync, neighbor sync needs fixed tile owners and one-cell halos";
+  }
+  if (opts->syncNeighbors && opts->frameFn) {
+    return "Invalid sync, frames are taken at the barrier, so need barrier sync";
+  }
+  if (opts->cycles < GOL_CYCLES_OFF || opts->cycles > GOL_CYCLES_SKIP) {
+    return "Invalid cycles, must be GOL_CYCLES_OFF, GOL_CYCLES_STOP or GOL_CYCLES_SKIP";
+  }
+  if (opts->cycles && (opts->engine == GOL_ENGINE_HASHLIFE || opts->haloDepth > 1 ||
+                       opts->syncNeighbors)) {
+    return "Invalid cycles, generations are hashed at the barrier between single"
+           " generations";
+  }
+  return NULL;
+}
+
+struct golSim *golCreate(const struct golOptions *opts) {
+  /*
+   * Purpose: Creates a simulation and its pool of workers. Options that
+   *          don't work still give a simulation, one whose every call
+   *          fails with the reason
+   * Inputs: Options: opts
+   * Returns: The simulation, for golDestroy to free
+   */
+  struct golSim *sim;
+  const char *invalid = checkOptions(opts);
+
+  if (!(sim = (struct golSim *)calloc(1, sizeof(struct golSim)))) {
+    printf("malloc error\n");
+    exit(1);
+  }
+  pthread_mutex_init(&sim->poolLock, NULL);
+  pthread_cond_init(&sim->poolWake, NULL);
+  pthread_cond_init(&sim->poolIdle, NULL);
+  pthread_mutex_init(&sim->ckptLock, NULL);
+  pthread_cond_init(&sim->ckptWake, NULL);
+  pthread_cond_init(&sim->ckptIdle, NULL);
+  pthread_mutex_init(&sim->frameLock, NULL);
+  pthread_cond_init(&sim->frameWake, NULL);
+  pthread_cond_init(&sim->frameFree, NULL);
+  sim->streamFd = -1;
+  if (invalid) {
+    sim->broken = 1;
+    golFail(sim, "%s", invalid);
+    return sim;
+  }
+
+  sim->autoEngine = opts->engine == GOL_ENGINE_AUTO;
+  sim->engine = sim->autoEngine ? GOL_ENGINE_CHAR : opts->engine;
+  sim->threadCount = opts->threads;
+  sim->partitionType = opts->partition;
+  sim->simdName = opts->simd ? opts->simd : "auto";
+  sim->rule = opts->rule ? opts->rule : "B3/S23";
+  parseRule(sim->rule, &sim->birth, &sim->survive);
+  sim->ruleKind = ruleKind(sim->birth, sim->survive);
+  sim->deadBoundary = opts->deadBoundary;
+  sim->tileRows = opts->tileRows;
+  sim->tileCols = opts->tileCols;
+  sim->workStealing = opts->workStealing;
+  sim->hugePages = opts->hugePages;
+  sim->activeTiles = opts->activeTiles;
+  sim->haloDepth = opts->haloDepth;
+  sim->syncNeighbors = opts->syncNeighbors;
+  sim->pinThreads = opts->pinThreads;
+  sim->numaMode = opts->numaMode;
+  sim->sizeRows = opts->rows;
+  sim->sizeCols = opts->cols;
+  sim->ckptFile = opts->checkpointFile;
+  sim->ckptEvery = opts->checkpointEvery;
+  sim->ckptState = CKPT_IDLE;
+  sim->frameFn = opts->frameFn;
+  sim->frameArg = opts->frameArg;
+  sim->frameEvery = opts->frameEvery;
+  sim->frameWait = opts->frameWait;
+  sim->frameDue[0] = sim->frameDue[1] = -1;
+  sim->profiling = opts->profiling || opts->hwCounters || opts->trace;
+  sim->timeTiles = sim->profiling || opts->loadBalance;
+  sim->hwCounters = opts->hwCounters;
+  sim->trace = opts->trace;
+  sim->hlStep = -1;
+  sim->cycles = opts->cycles;
+  sim->cycleStart = -1;
+  sim->streamFile = opts->engine == GOL_ENGINE_STREAM ? opts->streamFile : NULL;
+  sim->streamResume = opts->streamResume;
+  sim->shards = opts->shards;
+  sim->transport = findTransport(opts->transport);
+  sim->shard = -1;
+
+  if (!(sim->thread_args = (struct tid_args *)calloc(sim->threadCount, sizeof(struct tid_args)))) {
+    printf("malloc error\n");
+    exit(1);
+  }
+  if (pthread_barrier_init(&sim->barrier, 0, sim->threadCount)) {
+    perror("Pthread barrier init error\n");
+    exit(1);
+  }
+  poolStart(sim, sim->thread_args, sim->threadCount);
+  return sim;
+}
+
+int golLoad(struct golSim *sim, const char *filename) {
+  /*
+   * Purpose: Reads a seed file, with every worker on a big one, and builds
+   *          the boards, the partition and the engine's other structures
+   *          around it. A simulation takes one seed
+   * Inputs: Seed file: filename
+   * Returns: 0, or -1 if the seed can't be used; the simulation is then
+   *          only good for golDestroy
+   */
+  struct seed *seed = &sim->seed;
+  if (sim->broken) {
+    return -1;
+  }
+  if (sim->loaded) {
+    return golFail(sim, "A board is already loaded, create a new simulation for another");
+  }
+  if (openSeed(sim, filename) < 0) {
+    return loadFailed(sim);
+  }
+  seed->numChunks = (seed->format == SEED_NATIVE || seed->format == SEED_LIFE106) &&
+                    seed->size - seed->body > SEED_SPLIT ? sim->threadCount : 1;
+  seed->mode = PACKED(sim) ? SEED_MEASURE : SEED_LIST;
+  if (!(seed->chunks = (struct cellList *)calloc(seed->numChunks, sizeof(struct cellList)))) {
+    printf("malloc error\n");
+    exit(1);
+  }
+  poolRun(sim, parseChunk);
+  if (finishSeed(sim) < 0) {
+    return loadFailed(sim);
+  }
+  if (sim->autoEngine) {
+    sim->engine = chooseEngine(sim);
+  }
+
+  // Create game board initialized to starting state. Checkpoints pack rows
+  // into words whatever the engine. The sparse engine has no board, only
+  // the list placeSeed makes; the stream engine's is its file, and the
+  // shard engine's is shared memory its shards hand their bands back in
+  sim->words = (sim->cols+63)/64;
+  if (sim->engine == GOL_ENGINE_SPARSE) {
+    if (placeSeed(sim) < 0) {
+      return loadFailed(sim);
+    }
+    freeSeed(sim);
+    sim->loaded = 1;
+    return 0;
+  }
+  if (sim->engine == GOL_ENGINE_SHARD && sim->shards > sim->rows) {
+    golFail(sim, "Invalid shards, a board of %d rows can't be split into %d bands", sim->rows,
+            sim->shards);
+    return loadFailed(sim);
+  }
+  if (PACKED(sim)) {
+    if (openStream(sim) < 0 || (!sim->streamResumed && placePacked(sim) < 0)) {
+      return loadFailed(sim);
+    }
+    if (sim->engine == GOL_ENGINE_SHARD &&
+        !(sim->shardPids = (pid_t *)calloc(sim->shards, sizeof(pid_t)))) {
+      printf("malloc error\n");
+      exit(1);
+    }
+    freeSeed(sim);
+    sim->refBits = sim->bitBoards[0];
+    sim->loaded = 1;
+    return 0;
+  }
+  if (sim->engine == GOL_ENGINE_BIT) {
+    sim->wordStride = sim->words+2;
+    sim->boardBytes = (size_t)(sim->rows+2)*sim->wordStride*sizeof(uint64_t);
+  } else {
+    sim->stride = sim->cols+2;
+    sim->boardBytes = (size_t)(sim->rows+2)*sim->stride;
+  }
+  allocBoards(sim);
+
+  /*
+   *  Split the board among the workers
+   *  each thread takes a specified part of the board every round:
+   *    every thread reads the whole of the current board, but only writes
+   *    its own portion of the next one.
+   */
+  if (THREADED(sim)) {
+    partition(sim, sim->thread_args, sim->threadCount, sim->partitionType);
+    if (sim->workStealing) {
+      makeDeques(sim, sim->thread_args, sim->threadCount);
+    }
+    if (sim->activeTiles) {
+      makeTileChanged(sim);
+    }
+    if (sim->syncNeighbors) {
+      makeNeighbors(sim, sim->thread_args, sim->threadCount);
+    }
+    if (sim->cycles && !(sim->tileHash = (uint64_t *)calloc(sim->totalTiles, sizeof(uint64_t)))) {
+      printf("malloc error\n");
+      exit(1);
+    }
+  }
+
+  // Clear the boards, from the workers if their placement matters
+  if (THREADED(sim) && sim->numaMode != GOL_NUMA_NONE) {
+    poolRun(sim, touchPartition);
+  } else {
+    clearRegion(sim, 0, sim->rows-1, 0,
+                (sim->engine == GOL_ENGINE_BIT) ? sim->words-1 : sim->cols-1);
+  }
+  if (placeSeed(sim) < 0) {
+    return loadFailed(sim);
+  }
+  freeSeed(sim);
+  if (sim->engine == GOL_ENGINE_CHAR && selectKernel(sim) < 0) {
+    return loadFailed(sim);
+  }
+  sim->refBoard = sim->boards[0];
+  sim->refBits = sim->bitBoards[0];
+  sim->loaded = 1;
+  return 0;
+}
+
+int golRestore(struct golSim *sim, const char *filename) {
+  /*
+   * Purpose: Replaces the board with a checkpoint's and moves the
+   *          generation count to the checkpoint's. A missing checkpoint
+   *          leaves the board alone
+   * Inputs: Checkpoint file: filename
+   * Returns: 1 if the board now comes from the checkpoint, 0 if there was
+   *          none, -1 if it is not a checkpoint of this board
+   */
+  struct checkpointHeader header;
+  size_t n;
+  uint64_t *data, lastMask;
+  FILE *file;
+  int x, y, p;
+
+  if (checkLoaded(sim) < 0) {
+    return -1;
+  }
+  n = (size_t)sim->rows*sim->words;
+  if (!(file = fopen(filename, "rb"))) {
+    return 0;
+  }
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      memcmp(header.magic, CKPT_MAGIC, sizeof(header.magic))) {
+    fclose(file);
+    return golFail(sim, "Invalid checkpoint %s, not a checkpoint file", filename);
+  }
+  if (header.rows != sim->rows || header.cols != sim->cols) {
+    fclose(file);
+    return golFail(sim, "Invalid checkpoint %s, its board is %d x %d, not %d x %d", filename,
+                   header.rows, header.cols, sim->rows, sim->cols);
+  }
+  if (header.generation < 0) {
+    fclose(file);
+    return golFail(sim, "Invalid checkpoint %s, generation %ld is negative", filename,
+                   (long)header.generation);
+  }
+  // The stream and shard engines read straight into their spare board
+  if (PACKED(sim)) {
+    data = sim->bitBoards[1];
+  } else if (!(data = (uint64_t *)malloc(n*sizeof(uint64_t)))) {
+    printf("malloc error\n");
+    exit(1);
+  }
+  if (fread(data, sizeof(uint64_t), n, file) != n ||
+      fnv1a(data, n*sizeof(uint64_t)) != header.checksum) {
+    fclose(file);
+    if (!PACKED(sim)) {
+      free(data);
+    } else if (sim->engine == GOL_ENGINE_STREAM) {
+      adviseRows(sim, data, 0, sim->rows-1, MADV_DONTNEED);
+    }
+    return golFail(sim, "Invalid checkpoint %s, truncated or checksum mismatch", filename);
+  }
+  fclose(file);
+  if (PACKED(sim)) {
+    lastMask = ~(uint64_t)0 >> (63 - (sim->cols-1) % 64);
+    for (x = 0; x < sim->rows; x++) {
+      if (data[(size_t)x*sim->words + sim->words-1] & ~lastMask) {
+        data[(size_t)x*sim->words + sim->words-1] &= lastMask;
+      }
+    }
+    if (sim->engine == GOL_ENGINE_STREAM) {
+      adviseRows(sim, data, 0, sim->rows-1, MADV_DONTNEED);
+    }
+    sim->bitBoards[1] = sim->bitBoards[0];
+    sim->bitBoards[0] = data;
+    sim->refBits = data;
+    sim->generation = header.generation;
+    markStream(sim, sim->generation);
+    return 1;
+  }
+
+  lastMask = (sim->cols%64) ? ((uint64_t)1 << (sim->cols%64)) - 1 : ~(uint64_t)0;
+  if (sim->engine == GOL_ENGINE_SPARSE) {
+    sim->numLive = 0;
+    for (x = 0; x < sim->rows; x++) {
+      for (y = 0; y < sim->cols; y++) {
+        if ((data[(size_t)x*sim->words + y/64] >> (y%64)) & 1) {
+          addLive(sim, (uint64_t)x << 32 | (uint64_t)y);
+        }
+      }
+    }
+    sim->liveSorted = 1;
+  }
+  for (x = 0; x < sim->rows && sim->engine != GOL_ENGINE_SPARSE; x++) {
+    const uint64_t *row = data + (size_t)x*sim->words;
+    for (p = 0; p < 2; p++) {
+      if (sim->engine == GOL_ENGINE_BIT) {
+        memcpy(sim->bitBoards[p] + WORD(x,0), row, sim->words*sizeof(uint64_t));
+        sim->bitBoards[p][WORD(x,sim->words-1)] &= lastMask;
+      } else if (sim->boards[p]) {
+        for (y = 0; y < sim->cols; y++) {
+          sim->boards[p][CELL(x,y)] = ((row[y/64] >> (y%64)) & 1) ? '@' : '-';
+        }
+      }
+    }
+  }
+  for (p = 0; p < 2 && sim->engine != GOL_ENGINE_SPARSE; p++) {
+    if (sim->engine == GOL_ENGINE_BIT) {
+      refreshBitHalo(sim, sim->bitBoards[p], 0, sim->rows-1, 0, sim->words-1);
+    } else if (sim->boards[p]) {
+      refreshHalo(sim, sim->boards[p], 0, sim->rows-1, 0, sim->cols-1);
+    }
+  }
+  // The whole board may have changed
+  for (p = 0; sim->activeTiles && p < 2; p++) {
+    memset(sim->tileChanged[p], !p, sim->totalTiles);
+  }
+  free(data);
+  sim->generation = header.generation;
+  resetHistory(sim);
+  return 1;
+}
+
+static void planSteps(struct golSim *sim, int steps) {
+  /*
+   * Purpose: Sets up a run of steps generations from the current one:
+   *          which of them get checkpoints and frames
+   * Inputs: Number of generations: steps
+   * Returns: Nothing
+   */
+  sim->genBase = sim->generation;
+  sim->ckptLast = steps;
+  sim->frameSteps = THREADED(sim) ? steps : 0;
+  if (sim->ckptEvery) {
+    sim->ckptDue[0] = 0;
+    sim->ckptDue[1] = planCheckpoint(sim, 1);
+  }
+  if (sim->frameFn) {
+    sim->frameDue[0] = planFrame(sim, 0);
+    sim->frameDue[1] = planFrame(sim, 1);
+  }
+}
+
+static int runThreaded(struct golSim *sim, int steps) {
+  /*
+   * Purpose: Runs up to steps generations on the workers, then brings the
+   *          last one, and what goes with it, to index 0. A cycle found
+   *          during the run leaves the workers one generation past the
+   *          repeat; the repeat is still in the other board, and is the
+   *          one kept
+   * Inputs: Number of generations: steps
+   * Returns: The generations run, fewer than steps if a cycle stopped them
+   */
+  struct tid_args *args = sim->thread_args;
+  struct deque *dq;
+  unsigned char *changed;
+  uint64_t *bits;
+  char *board;
+  int supersteps, done, i;
+
+  for (i = 0; i < sim->threadCount; i++) {
+    args[i].iter = steps;
+    args[i].cursor = 0;
+    if (sim->syncNeighbors) {
+      sim->counters[i].done = 0;
+    }
+  }
+  sim->stopAt = steps;
+  poolRun(sim, sim->haloDepth > 1 ? evolveBlocked : evolve);
+  done = (sim->hashing && sim->cyclePeriod) ? (int)(sim->cycleStart+sim->cyclePeriod-sim->genBase)
+                                            : steps;
+
+  supersteps = (done+sim->haloDepth-1)/sim->haloDepth;
+  if (supersteps%2) {
+    board = sim->boards[0];
+    sim->boards[0] = sim->boards[1];
+    sim->boards[1] = board;
+    bits = sim->bitBoards[0];
+    sim->bitBoards[0] = sim->bitBoards[1];
+    sim->bitBoards[1] = bits;
+    changed = sim->tileChanged[0];
+    sim->tileChanged[0] = sim->tileChanged[1];
+    sim->tileChanged[1] = changed;
+    dq = sim->deques[0];
+    sim->deques[0] = sim->deques[1];
+    sim->deques[1] = dq;
+  }
+  sim->refBoard = sim->boards[0];
+  sim->refBits = sim->bitBoards[0];
+  return done;
+}
+
+static int runEngine(struct golSim *sim, int steps) {
+  /*
+   * Purpose: Runs up to steps generations on whichever engine the
+   *          simulation uses. Hashlife jumps straight to the last one on
+   *          this thread, the stream engine hands the workers a band at a
+   *          time, and the shard engine forks a process per band
+   * Inputs: Number of generations: steps
+   * Returns: The generations run, fewer than steps if a cycle stopped them,
+   *          or -1 if a shard was lost
+   */
+  if (sim->engine == GOL_ENGINE_HASHLIFE) {
+    runHashlife(sim, steps);
+    sim->hlLastNodes = sim->hlNodes;
+    hlFree(sim);
+    sim->refBoard = sim->boards[0];
+    return steps;
+  }
+  if (sim->engine == GOL_ENGINE_SPARSE) {
+    return runSparse(sim, steps);
+  }
+  if (sim->engine == GOL_ENGINE_STREAM) {
+    runStream(sim, steps);
+    return steps;
+  }
+  if (sim->engine == GOL_ENGINE_SHARD) {
+    return runShards(sim, steps);
+  }
+  return runThreaded(sim, steps);
+}
+
+static int skipCycle(struct golSim *sim, int steps) {
+  /*
+   * Purpose: Skips the whole periods of the board's cycle that fit in
+   *          steps generations. Matching hashes only suggest a cycle, so
+   *          until one is confirmed a period is run first and must come
+   *          back to the board it started from. If it doesn't, the hashes
+   *          collided: the cycle is forgotten and nothing is skipped
+   * Inputs: Generations left to run: steps
+   * Returns: The generations still to run, or -1 if a shard was lost
+   */
+  size_t n = (size_t)sim->rows*sim->words;
+  uint64_t *before, *after;
+  int done, rest, same;
+
+  if (steps < sim->cyclePeriod) {
+    return steps;
+  }
+  if (!sim->cycleConfirmed) {
+    if (!(before = (uint64_t *)malloc(n*sizeof(uint64_t))) ||
+        !(after = (uint64_t *)malloc(n*sizeof(uint64_t)))) {
+      printf("malloc error\n");
+      exit(1);
+    }
+    packRows(sim, before, sim->refBoard, sim->refBits, 0, sim->rows-1);
+    planSteps(sim, (int)sim->cyclePeriod);
+    if ((done = runEngine(sim, (int)sim->cyclePeriod)) < 0) {
+      free(before);
+      free(after);
+      return -1;
+    }
+    sim->generation += done;
+    sim->lastSteps += done;
+    steps -= done;
+    packRows(sim, after, sim->refBoard, sim->refBits, 0, sim->rows-1);
+    same = !memcmp(before, after, n*sizeof(uint64_t));
+    free(before);
+    free(after);
+    if (!same) {
+      sim->cycleStart = -1;
+      sim->cyclePeriod = 0;
+      return steps;
+    }
+    sim->cycleConfirmed = 1;
+  }
+  rest = steps % sim->cyclePeriod;
+  sim->cycleSkipped += steps-rest;
+  sim->generation += steps-rest;
+  return rest;
+}
+
+int golStep(struct golSim *sim, long n) {
+  /*
+   * Purpose: Applies the rules of the Game of Life n times, on the workers
+   *          or, for hashlife and the sparse engine, on the calling thread,
+   *          checkpointing and sampling frames along the way. Watching for
+   *          cycles, the step stops at the first generation to repeat an
+   *          earlier one, leaving the board on that generation whatever the
+   *          engine, or skips whole periods of the cycle and runs only what
+   *          is left over, once a period run in full has confirmed it
+   * Inputs: Number of generations: n
+   * Returns: 0, or -1 if n is out of range or a shard was lost
+   */
+  struct tid_args *args = sim->thread_args;
+  int steps, done, rest, found = 0, i;
+
+  if (checkLoaded(sim) < 0) {
+    return -1;
+  }
+  if (n < 0 || n > INT_MAX) {
+    return golFail(sim, "Invalid steps, must be between 0 and %d", INT_MAX);
+  }
+  steps = (int)n;
+  if (sim->ckptFile && !sim->ckptStarted && !PACKED(sim)) {
+    startCheckpoints(sim);
+  }
+  if (sim->frameFn && !sim->framesStarted) {
+    startFrames(sim);
+  }
+  if (THREADED(sim)) {
+    if (sim->profiling) {
+      if (sim->profiles) {
+        freeProfiles(sim, sim->threadCount);
+      }
+      makeProfiles(sim, sim->threadCount, steps);
+    }
+    sim->traceBase = now();
+    sim->totalSkipped = 0;
+    for (i = 0; i < sim->threadCount; i++) {
+      args[i].tilesDone = 0;
+      args[i].tilesStolen = 0;
+      args[i].busy = 0;
+    }
+  }
+
+  // A board known to be in a cycle skips its whole periods up front
+  sim->cycleSkipped = 0;
+  sim->lastSteps = 0;
+  sim->hashing = 0;
+  if (sim->cycles == GOL_CYCLES_SKIP && sim->cyclePeriod && (steps = skipCycle(sim, steps)) < 0) {
+    return -1;
+  }
+  sim->hashing = sim->cycles != GOL_CYCLES_OFF && !sim->cyclePeriod;
+  if (sim->hashing) {
+    if (sim->engine == GOL_ENGINE_SPARSE) {
+      sim->boardHash = hashLive(sim);
+    } else {
+      poolRun(sim, hashTiles);
+      sim->boardHash = 0;
+      for (i = 0; i < sim->threadCount; i++) {
+        sim->boardHash ^= args[i].hashDelta[0];
+        args[i].hashDelta[0] = args[i].hashDelta[1] = 0;
+      }
+    }
+    found = noteGeneration(sim, sim->generation, sim->boardHash);
+  }
+  planSteps(sim, steps);
+  done = found ? 0 : runEngine(sim, steps);
+  if (done < 0) {
+    return -1;
+  }
+  sim->generation += done;
+  sim->lastSteps += done;
+
+  // Stopped by a cycle: skip its whole periods and run the remainder
+  if (done < steps && sim->cycles == GOL_CYCLES_SKIP) {
+    sim->hashing = 0;
+    if ((rest = skipCycle(sim, steps-done)) < 0) {
+      return -1;
+    }
+    planSteps(sim, rest);
+    sim->generation += runEngine(sim, rest);
+    sim->lastSteps += rest;
+  }
+  sim->hashing = 0;
+  return 0;
+}
+
+int golGetCells(struct golSim *sim, uint64_t *cells) {
+  /*
+   * Purpose: Copies out the current generation, one bit per cell in the
+   *          layout of a golFrame
+   * Inputs: Room for golInfo's rows*words words: cells
+   * Returns: 0, or -1 if there is no board
+   */
+  if (checkLoaded(sim) < 0) {
+    return -1;
+  }
+  packRows(sim, cells, sim->refBoard, sim->refBits, 0, sim->rows-1);
+  return 0;
+}
+
+int golCell(struct golSim *sim, int x, int y) {
+  /*
+   * Purpose: Reads one cell of the current generation
+   * Inputs: Coordinates: x, y
+   * Returns: 1 if the cell is alive, 0 if dead, -1 if it is off the board
+   */
+  if (checkLoaded(sim) < 0) {
+    return -1;
+  }
+  if (x < 0 || x >= sim->rows || y < 0 || y >= sim->cols) {
+    return golFail(sim, "Invalid cell, %d %d is off the %d x %d board", x, y, sim->rows,
+                   sim->cols);
+  }
+  return isAlive(sim, x, y);
+}
+
+long golLiveCells(struct golSim *sim, int *coords, long max) {
+  /*
+   * Purpose: Lists the live cells of the current generation in row-major
+   *          order, as row, column pairs, without the dense copy of
+   *          golGetCells. Called with no room it just counts them
+   * Inputs: Room for max pairs, or NULL: coords, max
+   * Returns: The number of live cells, which may be more than max, or -1
+   *          if there is no board
+   */
+  uint64_t *row, bits;
+  long count = 0;
+  int x, w, y;
+
+  if (checkLoaded(sim) < 0) {
+    return -1;
+  }
+  if (sim->engine == GOL_ENGINE_SPARSE) {
+    sortLive(sim);
+    for (count = 0; count < sim->numLive && count < max; count++) {
+      coords[2*count] = (int)(sim->live[count] >> 32);
+      coords[2*count+1] = (int)(sim->live[count] & 0xffffffff);
+    }
+    return sim->numLive;
+  }
+  if (!(row = (uint64_t *)malloc(sim->words*sizeof(uint64_t)))) {
+    printf("malloc error\n");
+    exit(1);
+  }
+  for (x = 0; x < sim->rows; x++) {
+    packRow(sim, row, sim->refBoard, sim->refBits, x);
+    for (w = 0; w < sim->words; w++) {
+      for (bits = row[w]; bits; bits &= bits-1) {
+        y = w*64 + __builtin_ctzll(bits);
+        if (count < max) {
+          coords[2*count] = x;
+          coords[2*count+1] = y;
+        }
+        count++;
+      }
+    }
+    if (sim->engine == GOL_ENGINE_STREAM && ((x+1) % sim->streamBand == 0 || x == sim->rows-1)) {
+      adviseRows(sim, sim->refBits, x - x % sim->streamBand, x, MADV_DONTNEED);
+    }
+  }
+  free(row);
+  return count;
+}
+
+int golSave(struct golSim *sim, const char *filename) {
+  /*
+   * Purpose: Checkpoints the current generation, once any periodic
+   *          checkpoint still being written is done
+   * Inputs: Checkpoint file: filename
+   * Returns: 0, or -1 if the file couldn't be written
+   */
+  uint64_t *data;
+  int saved;
+  if (checkLoaded(sim) < 0) {
+    return -1;
+  }
+  // The stream and shard engines' boards are already in checkpoint layout
+  if (PACKED(sim)) {
+    saved = writeCheckpoint(sim, filename, sim->refBits, sim->generation, sim->error);
+    if (sim->engine == GOL_ENGINE_STREAM) {
+      adviseRows(sim, sim->refBits, 0, sim->rows-1, MADV_DONTNEED);
+    }
+    sim->ckptWritten += saved;
+    return saved ? 0 : -1;
+  }
+  if (sim->ckptStarted) {
+    waitCheckpoint(sim);
+    data = sim->ckptData;
+  } else if (!(data = (uint64_t *)malloc((size_t)sim->rows*sim->words*sizeof(uint64_t)))) {
+    printf("malloc error\n");
+    exit(1);
+  }
+  packRows(sim, data, sim->refBoard, sim->refBits, 0, sim->rows-1);
+  saved = writeCheckpoint(sim, filename, data, sim->generation, sim->error);
+  if (!sim->ckptStarted) {
+    free(data);
+  }
+  sim->ckptWritten += saved;
+  return saved ? 0 : -1;
+}
+
+int golPushFrame(struct golSim *sim) {
+  /*
+   * Purpose: Hands the current generation to the frame callback. Steps only
+   *          sample the generations they read, so a run's last generation
+   *          is shown this way
+   * Inputs: Nothing
+   * Returns: 0, or -1 if there is no board or no callback
+   */
+  if (checkLoaded(sim) < 0) {
+    return -1;
+  }
+  if (!sim->frameFn) {
+    return golFail(sim, "No frame callback, set frameFn to take frames");
+  }
+  if (!sim->framesStarted) {
+    startFrames(sim);
+  }
+  pushFrame(sim, sim->generation);
+  return 0;
+}
+
+int golFlush(struct golSim *sim) {
+  /*
+   * Purpose: Waits for every queued frame to reach the callback and for
+   *          any periodic checkpoint to reach the disk
+   * Inputs: Nothing
+   * Returns: 0, or -1 if there is no board or a periodic checkpoint
+   *          failed since the last golFlush, golError saying why the
+   *          latest one did
+   */
+  if (checkLoaded(sim) < 0) {
+    return -1;
+  }
+  if (sim->framesStarted) {
+    waitFrames(sim);
+  }
+  if (sim->ckptStarted) {
+    waitCheckpoint(sim);
+  }
+  if (sim->ckptError[0]) {
+    golFail(sim, "%s", sim->ckptError);
+    sim->ckptError[0] = '\0';
+    return -1;
+  }
+  return 0;
+}
+
+int golInfo(struct golSim *sim, struct golInfo *info) {
+  /*
+   * Purpose: Describes the board and what has happened to it so far
+   * Inputs: Result: info
+   * Returns: 0, or -1 if there is no board
+   */
+  if (checkLoaded(sim) < 0) {
+    return -1;
+  }
+  info->engine = sim->engine;
+  info->rows = sim->rows;
+  info->cols = sim->cols;
+  info->words = sim->words;
+  info->generation = sim->generation;
+  info->seedIters = sim->seed.iters;
+  info->seedCells = sim->seed.numCoords;
+  info->tiles = sim->totalTiles;
+  pthread_mutex_lock(&sim->ckptLock);
+  info->checkpointsWritten = sim->ckptWritten;
+  info->checkpointsSkipped = sim->ckptSkipped;
+  info->checkpointsFailed = sim->ckptFailed;
+  pthread_mutex_unlock(&sim->ckptLock);
+  pthread_mutex_lock(&sim->frameLock);
+  info->framesShown = sim->framesShown;
+  info->framesDropped = sim->framesDropped;
+  pthread_mutex_unlock(&sim->frameLock);
+  info->skippedTiles = sim->totalSkipped;
+  info->cycleStart = sim->cycleStart;
+  info->cyclePeriod = sim->cyclePeriod;
+  info->cycleSkipped = sim->cycleSkipped;
+  info->resumed = sim->streamResumed;
+  return 0;
+}
+
+void golReport(struct golSim *sim, int sections) {
+  /*
+   * Purpose: Prints the chosen GOL_REPORT_* sections about the board and
+   *          the last golStep, skipping those that don't apply
+   * Inputs: Sections: sections
+   * Returns: Nothing
+   */
+  int i, threaded = THREADED(sim);
+  if (checkLoaded(sim) < 0) {
+    return;
+  }
+  for (i = 0; (sections & GOL_REPORT_PARTITIONS) && threaded && i < sim->threadCount; i++) {
+    if (sim->partitionType == 2) {
+      printTiles(sim, sim->thread_args, i);
+    } else {
+      printPartitions(sim->thread_args, i, 1);
+    }
+  }
+  if ((sections & GOL_REPORT_KERNEL) && sim->engine == GOL_ENGINE_CHAR) {
+    printf("Row kernel: %s\n", sim->simdName);
+  }
+  if ((sections & GOL_REPORT_KERNEL) && sim->ruleKind != RULE_LIFE) {
+    printf("Rule: %s%s\n", sim->rule, (sim->ruleKind == RULE_TABLE && THREADED(sim)) ?
+           ", on the table kernels" : "");
+  }
+  if ((sections & GOL_REPORT_KERNEL) && sim->engine == GOL_ENGINE_SPARSE) {
+    printf("Sparse engine%s: %ld live cells on a %d x %d board\n",
+           sim->autoEngine ? ", chosen for the seed's low density" : "", sim->numLive,
+           sim->rows, sim->cols);
+  }
+  if ((sections & GOL_REPORT_KERNEL) && sim->engine == GOL_ENGINE_STREAM) {
+    printf("Stream engine: %s, %zu bytes per generation, bands of %d rows\n", sim->streamFile,
+           sim->streamHalf, sim->streamBand);
+  }
+  for (i = 0; (sections & GOL_REPORT_PARTITIONS) && sim->engine == GOL_ENGINE_SHARD &&
+              i < sim->shards; i++) {
+    printf("Shard %d: rows %d to %d\n", i, bandStart(sim, i), bandStart(sim, i+1)-1);
+  }
+  if ((sections & GOL_REPORT_KERNEL) && sim->engine == GOL_ENGINE_SHARD) {
+    printf("Shard engine: %d processes over %s, %zu bytes of edge rows passed per generation\n",
+           sim->shards, sim->transport->name,
+           (size_t)2*(sim->deadBoundary ? sim->shards-1 : sim->shards)*sim->words*
+           sizeof(uint64_t));
+  }
+  if ((sections & GOL_REPORT_HASHLIFE) && sim->engine == GOL_ENGINE_HASHLIFE) {
+    printf("Hashlife: %zu nodes, %d collections\n", sim->hlLastNodes, sim->hlCollections);
+  }
+  if ((sections & GOL_REPORT_SPARSE) && sim->engine == GOL_ENGINE_SPARSE) {
+    printf("Sparse: %ld live cells, at most %ld, table of %zu slots\n", sim->numLive,
+           sim->livePeak, sim->sparseSize);
+  }
+  if ((sections & GOL_REPORT_BALANCE) && threaded) {
+    printLoadBalance(sim, sim->thread_args, sim->threadCount);
+  }
+  if ((sections & GOL_REPORT_PLACEMENT) && threaded) {
+    printPlacement(sim, sim->thread_args, sim->threadCount);
+  }
+  if ((sections & GOL_REPORT_PROFILE) && sim->profiles) {
+    printProfile(sim, sim->threadCount);
+  }
+  if ((sections & GOL_REPORT_SKIPPED) && sim->activeTiles) {
+    printf("Skipped %ld of %ld tile updates (%.1f%%)\n", sim->totalSkipped,
+           (long)sim->totalTiles*sim->lastSteps,
+           sim->lastSteps ? 100.0*sim->totalSkipped/((double)sim->totalTiles*sim->lastSteps) : 0.0);
+  }
+  if ((sections & GOL_REPORT_CYCLE) && sim->cycles && sim->cyclePeriod) {
+    printf("Cycle of period %ld entered at generation %ld", sim->cyclePeriod, sim->cycleStart);
+    if (sim->cycles == GOL_CYCLES_SKIP) {
+      printf(", %ld generations skipped\n", sim->cycleSkipped);
+    } else {
+      printf(", stopped at generation %ld\n", sim->generation);
+    }
+  } else if ((sections & GOL_REPORT_CYCLE) && sim->cycles) {
+    printf("No cycle found by generation %ld\n", sim->generation);
+  }
+  if ((sections & GOL_REPORT_OUTPUT) && sim->ckptFile) {
+    printf("Checkpoints: %ld written, %ld failed, %ld skipped while the writer was busy\n",
+           sim->ckptWritten, sim->ckptFailed, sim->ckptSkipped);
+  }
+  if ((sections & GOL_REPORT_OUTPUT) && sim->frameFn) {
+    printf("Frames: %ld shown, %ld dropped while the writer was busy\n",
+           sim->framesShown, sim->framesDropped);
+  }
+}
+
+int golWriteTrace(struct golSim *sim, const char *filename) {
+  /*
+   * Purpose: Saves the last golStep's phases as a Chrome trace
+   * Inputs: Trace file: filename
+   * Returns: 0, or -1 if nothing was traced or the file can't be written
+   */
+  if (checkLoaded(sim) < 0) {
+    return -1;
+  }
+  if (!sim->trace || !sim->profiles) {
+    return golFail(sim, "No trace, set the trace option and step first");
+  }
+  return writeTrace(sim, filename, sim->threadCount);
+}
+
+const char *golError(struct golSim *sim) {
+  /*
+   * Purpose: Explains the last call that failed
+   * Inputs: Nothing
+   * Returns: The message, or NULL if no call has failed
+   */
+  return sim->error[0] ? sim->error : NULL;
+}
+
+void golDestroy(struct golSim *sim) {
+  /*
+   * Purpose: Drains the frame and checkpoint writers, stops every thread
+   *          and frees the simulation
+   * Inputs: Nothing
+   * Returns: Nothing
+   */
+  int i;
+  if (sim == NULL) {
+    return;
+  }
+  if (sim->framesStarted) {
+    stopFrames(sim);
+  }
+  if (sim->ckptStarted) {
+    stopCheckpoints(sim);
+  }
+  if (sim->poolTids) {
+    poolStop(sim);
+  }
+  if (sim->thread_args) {
+    pthread_barrier_destroy(&sim->barrier);
+  }
+  if (sim->profiles) {
+    freeProfiles(sim, sim->threadCount);
+  }
+  if (sim->counters) {
+    freeNeighbors(sim, sim->thread_args, sim->threadCount);
+  }
+  if (sim->deques[0]) {
+    freeDeques(sim, sim->threadCount);
+  }
+  free(sim->tileChanged[0]);
+  free(sim->tileChanged[1]);
+  if (sim->streamMap) {
+    munmap(sim->streamMap, sim->streamHead + 2*sim->streamHalf);
+    sim->bitBoards[0] = sim->bitBoards[1] = NULL;
+  }
+  if (sim->streamFd >= 0) {
+    close(sim->streamFd);
+  }
+  for (i = 0; sim->thread_args && i < sim->threadCount; i++) {
+    free(sim->thread_args[i].streamRows);
+  }
+  free(sim->thread_args);
+  free(sim->shardPids);
+  free(sim->tiles);
+  freeSeed(sim);
+  freeBoard(sim, sim->boards[0]);
+  freeBoard(sim, sim->boards[1]);
+  freeBoard(sim, sim->bitBoards[0]);
+  freeBoard(sim, sim->bitBoards[1]);
+  free(sim->tileHash);
+  free(sim->history);
+  free(sim->historyRing);
+  free(sim->live);
+  free(sim->sparseKeys);
+  free(sim->sparseCounts);
+  pthread_mutex_destroy(&sim->poolLock);
+  pthread_cond_destroy(&sim->poolWake);
+  pthread_cond_destroy(&sim->poolIdle);
+  pthread_mutex_destroy(&sim->ckptLock);
+  pthread_cond_destroy(&sim->ckptWake);
+  pthread_cond_destroy(&sim->ckptIdle);
+  pthread_mutex_destroy(&sim->frameLock);
+  pthread_cond_destroy(&sim->frameWake);
+  pthread_cond_destroy(&sim->frameFree);
+  free(sim);
+}
@@ -0,0 +1,165 @@
+//
+// Zach Lockett-Streiff; Taylor Nation; Jacob Lewin
+// Conway's Game of Life as a library: the threaded engines behind an opaque
+// simulation handle
+//
+// Every simulation owns its boards, its pool of worker threads and its
+// checkpoint and frame writers, so any number of them can be created and
+// stepped at once from different threads. A single handle is not itself
+// thread-safe: one thread at a time calls into it. A typical run is
+//
+//   struct golOptions opts;
+//   golDefaults(&opts);
+//   opts.threads = 4;
+//   struct golSim *sim = golCreate(&opts);
+//   if (golLoad(sim, "gosper.txt") < 0 || golStep(sim, 100) < 0) {
+//     printf("%s\n", golError(sim));
+//   }
+//   golDestroy(sim);
+//
+// Calls that can fail return -1 and leave a message for golError; only a
+// failed allocation or thread creation still ends the process
+//
+#ifndef GOLSIM_H
+#define GOLSIM_H
+
+#include <stdint.h>
+
+// Engines. GOL_ENGINE_AUTO runs the char engine, or the sparse one when the
+// seed leaves the board almost empty, no option needs the workers and the
+// rule has no B0. GOL_ENGINE_STREAM keeps the board in a file, for boards
+// larger than memory, and GOL_ENGINE_SHARD splits it into row bands run by
+// processes of their own; both are only run when asked for. The stream
+// engine only asks the kernel to read the next band ahead with
+// MADV_WILLNEED; it does no I/O of its own alongside the compute, so rows
+// the kernel hasn't read in by the time they are reached are faulted in
+// then, and the workers wait for them
+#define GOL_ENGINE_CHAR     0
+#define GOL_ENGINE_BIT      1
+#define GOL_ENGINE_HASHLIFE 2
+#define GOL_ENGINE_SPARSE   3
+#define GOL_ENGINE_AUTO     4
+#define GOL_ENGINE_STREAM   5
+#define GOL_ENGINE_SHARD    6
+
+// Board placement across NUMA nodes
+#define GOL_NUMA_NONE        0
+#define GOL_NUMA_FIRST_TOUCH 1
+#define GOL_NUMA_INTERLEAVE  2
+#define GOL_NUMA_LOCAL       3
+
+// What golStep does once the board repeats an earlier generation, which it
+// only watches for when asked: stop there, or skip whole periods of the
+// cycle to reach the generation asked for. Only the last 262144
+// generations are remembered, so longer periods go unnoticed
+#define GOL_CYCLES_OFF  0
+#define GOL_CYCLES_STOP 1
+#define GOL_CYCLES_SKIP 2
+
+// Sections of golReport
+#define GOL_REPORT_PARTITIONS 0x01
+#define GOL_REPORT_KERNEL     0x02
+#define GOL_REPORT_BALANCE    0x04
+#define GOL_REPORT_PLACEMENT  0x08
+#define GOL_REPORT_HASHLIFE   0x10
+#define GOL_REPORT_SKIPPED    0x20
+#define GOL_REPORT_PROFILE    0x40
+#define GOL_REPORT_OUTPUT     0x80
+#define GOL_REPORT_SPARSE     0x100
+#define GOL_REPORT_CYCLE      0x200
+
+// A generation handed to a frame callback: rows of cols cells, one bit per
+// cell, each row padded to words 64-bit words with column y in bit y%64 of
+// word y/64. skipped is the number of tiles --active skipped producing it,
+// or -1 if not known. The cells belong to the simulation and are only valid
+// during the call
+struct golFrame{
+  long gen;
+  int rows;
+  int cols;
+  int words;
+  const uint64_t *cells;
+  int skipped;
+  int tiles;
+};
+typedef void (*golFrameFn)(void *arg, const struct golFrame *frame);
+
+// How a simulation runs, filled with the defaults by golDefaults. Strings
+// are not copied and must outlive the simulation
+struct golOptions{
+  int engine;           // GOL_ENGINE_*
+  int threads;          // workers in the pool
+  int partition;        // 0 rows, 1 columns, 2 tiles
+  const char *simd;     // row kernel: auto, avx512, avx2, sse2 or scalar
+  const char *rule;     // birth/survival rule such as "B36/S23"; B0 not for hashlife or sparse
+  int deadBoundary;     // 1 for a dead boundary, 0 for a torus
+  int tileRows;         // tile size for partition 2, 0 to size from the caches
+  int tileCols;
+  int workStealing;     // idle workers steal tiles
+  int hugePages;        // back the boards with huge pages
+  int activeTiles;      // skip tiles that cannot change
+  int haloDepth;        // generations per barrier, char engine only
+  int syncNeighbors;    // wait on neighboring threads instead of a barrier
+  int pinThreads;       // bind each worker to a CPU
+  int numaMode;         // GOL_NUMA_*
+  int rows;             // board size, 0 to take it from the seed
+  int cols;
+  const char *checkpointFile;  // file for golSave's periodic snapshots
+  int checkpointEvery;  // snapshot generations that are multiples of this
+  golFrameFn frameFn;   // called, on a writer thread, with sampled frames
+  void *frameArg;
+  int frameEvery;       // sample generations that are multiples of this
+  int frameWait;        // 1 to stall the workers rather than drop frames
+  int profiling;        // time each worker's phases
+  int loadBalance;      // time each worker's tiles for GOL_REPORT_BALANCE
+  int hwCounters;       // count hardware events in each phase too
+  int trace;            // keep each phase as an event for golWriteTrace
+  int cycles;           // GOL_CYCLES_*; not for hashlife, halo depth or neighbor sync
+  const char *streamFile;  // file, created or truncated, holding the stream engine's boards
+  int streamResume;     // carry on from the board already in streamFile, if there is one
+  int shards;           // processes the shard engine splits the board between
+  const char *transport;  // how shards pass rows: "shm" or "socket"
+};
+
+// Facts about a loaded simulation, from golInfo
+struct golInfo{
+  int engine;           // GOL_ENGINE_*, never AUTO once loaded
+  int rows;
+  int cols;
+  int words;
+  long generation;
+  long seedIters;       // iterations in the seed's header, or -1
+  long seedCells;       // live cells the seed placed
+  int tiles;
+  long checkpointsWritten;
+  long checkpointsSkipped;
+  long checkpointsFailed;  // periodic checkpoints the writer couldn't save; golFlush says why
+  long framesShown;
+  long framesDropped;
+  long skippedTiles;    // tile updates --active skipped in the last golStep
+  long cycleStart;      // first generation of the cycle the board is in, or -1
+  long cyclePeriod;     // the cycle's period, 0 until one is found
+  long cycleSkipped;    // generations the last golStep skipped over
+  int resumed;          // 1 if golLoad carried on from the board in streamFile
+};
+
+struct golSim;
+
+void golDefaults(struct golOptions *opts);
+struct golSim *golCreate(const struct golOptions *opts);
+int golLoad(struct golSim *sim, const char *filename);
+int golRestore(struct golSim *sim, const char *filename);
+int golStep(struct golSim *sim, long n);
+int golGetCells(struct golSim *sim, uint64_t *cells);
+int golCell(struct golSim *sim, int x, int y);
+long golLiveCells(struct golSim *sim, int *coords, long max);
+int golSave(struct golSim *sim, const char *filename);
+int golPushFrame(struct golSim *sim);
+int golFlush(struct golSim *sim);
+int golInfo(struct golSim *sim, struct golInfo *info);
+void golReport(struct golSim *sim, int sections);
+int golWriteTrace(struct golSim *sim, const char *filename);
+const char *golError(struct golSim *sim);
+void golDestroy(struct golSim *sim);
+
+#endif
@@ -0,0 +1,156 @@
+#!/bin/sh
+#
+# Regression test for thread_gol, run by `make test`.
+#
+# Evolves random soups on non-square boards, including one-row and
+# one-column strips, with every engine over a matrix of thread counts,
+# partition types, boundaries and rules, and compares each final board,
+# written with --output, against the sparse engine's for the same board.
+# The sparse engine keeps a table of live cells rather than a grid, so it
+# shares no indexing with the engines under test. Any difference or failed
+# run is reported and the test exits nonzero. The matrix is set from the
+# environment:
+#
+#   SHAPES="37x211 211x37 2x97 97x3 1x64 130x1"  THREADS="1 3"
+#   PARTITIONS="0 1 2"  BOUNDARIES="torus dead"  RULES="B3/S23 B36/S23"
+#   ENGINES="char bit hashlife stream shard"  ITERS=20  DENSITY=0.35
+#   CYCLE_PATTERNS="pulsar.txt oscillator.txt walker.txt gosper.txt"
+#   CYCLE_ITERS=1000  BIN=./thread_gol
+#
+# Hashlife only runs on a torus. The shard engine runs as many shards as
+# threads, and at least two, so it is skipped on boards with fewer rows.
+#
+# The shipped patterns then run into their cycles with --cycles=stop and
+# --cycles=skip on every engine that watches for cycles, the char and bit
+# engines with and without --active, and must report the same cycle and
+# stop on the same board as the sparse engine.
+#
+
+SHAPES=${SHAPES:-"37x211 211x37 2x97 97x3 1x64 130x1"}
+THREADS=${THREADS:-"1 3"}
+PARTITIONS=${PARTITIONS:-"0 1 2"}
+BOUNDARIES=${BOUNDARIES:-"torus dead"}
+RULES=${RULES:-"B3/S23 B36/S23"}
+ENGINES=${ENGINES:-"char bit hashlife stream shard"}
+ITERS=${ITERS:-20}
+CYCLE_PATTERNS=${CYCLE_PATTERNS:-"pulsar.txt oscillator.txt walker.txt gosper.txt"}
+CYCLE_ITERS=${CYCLE_ITERS:-1000}
+DENSITY=${DENSITY:-0.35}
+BIN=${BIN:-./thread_gol}
+
+if [ ! -x "$BIN" ]; then
+  echo "No $BIN, run make first"
+  exit 1
+fi
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+runs=0
+failures=0
+
+# soup ROWS COLS: writes a ROWS x COLS random board in the native format
+soup() {
+  awk -v r="$1" -v c="$2" -v d="$DENSITY" -v iters="$ITERS" 'BEGIN {
+    srand(r * 1000 + c)
+    for (x = 0; x < r; x++) {
+      for (y = 0; y < c; y++) {
+        if (rand() < d) {
+          cells[count++] = x " " y
+        }
+      }
+    }
+    print r; print c; print iters; print count
+    for (i = 0; i < count; i++) {
+      print cells[i]
+    }
+  }' > "$WORK/soup$1x$2.txt"
+}
+
+# check INPUT ENGINE THREADS PARTITION BOUNDARY RULE [OPTION]: runs a
+# configuration and compares its board with $WORK/expected.txt
+check() {
+  runs=$((runs+1))
+  desc="$(basename "$1") $2 threads=$3 partition=$4 boundary=$5 rule=$6"
+  if ! "$BIN" "$1" 0 "$3" "$4" 0 --engine="$2" --boundary="$5" --rule="$6" $7 \
+              --output="$WORK/got.txt" > "$WORK/log" 2>&1; then
+    echo "FAIL $desc: $(tail -n 1 "$WORK/log")"
+    failures=$((failures+1))
+  elif ! cmp -s "$WORK/expected.txt" "$WORK/got.txt"; then
+    echo "FAIL $desc: board differs from the sparse engine's"
+    failures=$((failures+1))
+  fi
+}
+
+# cycle INPUT ENGINE THREADS PARTITION MODE [OPTION]: runs a pattern into
+# its cycle and writes its board to $WORK/got.txt and its cycle report to
+# $WORK/got.cycle
+cycle() {
+  "$BIN" "$1" 0 "$3" "$4" 0 --engine="$2" --cycles="$5" --iters="$CYCLE_ITERS" $6 \
+         --output="$WORK/got.txt" > "$WORK/log" 2>&1 &&
+    grep -a "^Cycle" "$WORK/log" > "$WORK/got.cycle"
+}
+
+for shape in $SHAPES; do
+  rows=${shape%x*}
+  cols=${shape#*x}
+  soup "$rows" "$cols"
+  input="$WORK/soup$shape.txt"
+  for boundary in $BOUNDARIES; do
+    for rule in $RULES; do
+      if ! "$BIN" "$input" 0 1 0 0 --engine=sparse --boundary="$boundary" --rule="$rule" \
+                  --output="$WORK/expected.txt" > "$WORK/log" 2>&1; then
+        echo "FAIL $shape sparse boundary=$boundary rule=$rule: $(tail -n 1 "$WORK/log")"
+        failures=$((failures+1))
+        continue
+      fi
+      for engine in $ENGINES; do
+        [ "$engine" = hashlife ] && [ "$boundary" != torus ] && continue
+        for threads in $THREADS; do
+          shards=$((threads < 2 ? 2 : threads))
+          [ "$engine" = shard ] && [ "$rows" -lt "$shards" ] && continue
+          for part in $PARTITIONS; do
+            case $engine in
+              stream) option="--stream=$WORK/stream.bin" ;;
+              shard) option="--shards=$shards" ;;
+              *) option="" ;;
+            esac
+            check "$input" "$engine" "$threads" "$part" "$boundary" "$rule" "$option"
+          done
+        done
+      done
+    done
+  done
+done
+
+for pattern in $CYCLE_PATTERNS; do
+  for mode in stop skip; do
+    if ! cycle "$pattern" sparse 1 0 "$mode"; then
+      echo "FAIL $pattern sparse cycles=$mode: $(tail -n 1 "$WORK/log")"
+      failures=$((failures+1))
+      continue
+    fi
+    mv "$WORK/got.txt" "$WORK/expected.txt"
+    mv "$WORK/got.cycle" "$WORK/expected.cycle"
+    for engine in char bit; do
+      for threads in $THREADS; do
+        for part in $PARTITIONS; do
+          for option in "" --active; do
+            runs=$((runs+1))
+            desc="$pattern $engine threads=$threads partition=$part cycles=$mode $option"
+            if ! cycle "$pattern" "$engine" "$threads" "$part" "$mode" "$option"; then
+              echo "FAIL $desc: $(tail -n 1 "$WORK/log")"
+              failures=$((failures+1))
+            elif ! cmp -s "$WORK/expected.cycle" "$WORK/got.cycle" ||
+                 ! cmp -s "$WORK/expected.txt" "$WORK/got.txt"; then
+              echo "FAIL $desc: cycle or board differs from the sparse engine's"
+              failures=$((failures+1))
+            fi
+          done
+        done
+      done
+    done
+  done
+done
+
+echo "$runs runs, $failures failed"
+[ "$failures" -eq 0 ]
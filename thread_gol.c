@@ -2,110 +2,76 @@
 // Zach Lockett-Streiff; Taylor Nation; Jacob Lewin
 // Implementation of Conway's Game of Life - Threaded Implementation
 //
+// The command line front end: reads the arguments into a golOptions, runs
+// one simulation of golsim.h and draws, saves and reports what it did. With
+// --batch the config file is instead a manifest of seeds, each run as its
+// own one-thread simulation with numTIDs of them going at once
+//
+#define _GNU_SOURCE
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/time.h>
 #include <string.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <limits.h>
+#include <time.h>
 #include <pthread.h>
+#include "golsim.h"
+
+// How --frames images are encoded
+#define FRAME_PBM 0
+#define FRAME_PGM 1
 
 // GLOBAL VARIABLES:
-char *newBoard;
-char *refBoard;
-int rows;
-int cols;
-struct tid_args *thread_args;
-static pthread_mutex_t my_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_barrier_t barrier;
-static pthread_barrier_t barrier2;
-
-struct tid_args{
-  int my_tid;
-  int startRow;
-  int endRow;
-  int startCol;
-  int endCol;
-  int willPrint;
-  int iter;
+// The options that belong to the front end rather than the simulation.
+// Frames shown with printCondition 1 or saved with --frames reach drawFrame
+// on the simulation's frame writer thread, in generation order
+char *outFile = NULL;
+char *traceFile = NULL;
+int itersOption = -1;
+int restartRun = 0;
+int activeTiles = 0;
+int frameTerminal = 0;
+char *framePrefix = NULL;
+int frameFormat = FRAME_PBM;
+int frameDelay = 500;
+char *frameText = NULL;
+int batchRun = 0;
+
+// One seed of a --batch manifest and how its run went
+struct batchBoard{
+  char *file;
+  long iters;           // iterations from the manifest, or -1
+  int rows;
+  int cols;
+  long steps;
+  long live;
+  double seconds;
+  char *error;          // why the board failed, or NULL
 };
 
-char* makeBoard(int rows, int cols, FILE* file, int numCoords);
-void verifyCmdArgs(int argc, char *argv[]);
-int numNeighbors(int xCoord, int yCoord);
-char *copyBoard(char *board, int rows, int cols);
-void *evolve(void *args);
-void print(int willPrint);
-FILE *openFile(char *filename[]);
-
-char* makeBoard(int rows, int cols, FILE* file, int numCoords){
-  /*
-   * Purpose: Creates the game board as a 1D array
-   * Inputs: Rows & Columns:        rows, cols
-   *         Input file:            file
-   *         Number of coordinates: numCoords
-   *          
-   * Returns: Nothing
-   */
- 
-  // Allocate space for array
-  rewind(file);
-  int a,b,c,d;
-  fscanf(file,"%d %d %d %d",&a,&b,&c,&d);
-  char* array = NULL;
-  array = (char *)malloc(sizeof(char)*(rows*cols));
-  
-  // Verify malloc worked
-  if (array == NULL) {
-    printf("malloc failed");
-    exit(1);
-  }
-
-  // Initialize elements of board array to '-'
-  int i,j,x,y,counter;
-  x = 0;
-  y = 0;
-  counter = 0;
-  for(i = 0; i < rows; i++){
-  	for(j = 0; j < cols; j++){
-  		array[i*rows+j]= '-';
-  	 }
-  }
-
-  // Read in coordinates to update board to its initial state
-  while(counter < numCoords){
-    if(file == NULL){
-      perror("This is the error: ");
-      exit(1);
-    
-    }
-    fscanf(file, "%d%d", &x,&y);
-	array[x*rows+y]='@';
-	counter++;
-  }
-  
-  return array;
-}
+// What the batch workers share: boards are claimed through next
+struct batch{
+  struct batchBoard *boards;
+  int numBoards;
+  int next;
+  const struct golOptions *opts;
+};
 
-void print(int willPrint) {
-  /*
-   *
-   *
-   * */
-  if (!willPrint) {
-    return;
-  }
-  int i;
-  for (i = 0; i < rows*cols; i++) {
-    printf("%c ",refBoard[i]);
-    if (!((i+1) % cols)) {
-      printf("\n");
-    }
-  }
-  if (willPrint) {
-    printf("\n");
-  }
-  usleep(500000);
-}
+void verifyCmdArgs(int argc, char *argv[]);
+void parseOptions(int argc, char *argv[], struct golOptions *opts);
+void showFrame(const struct golFrame *f);
+void saveFrame(const struct golFrame *f);
+void drawFrame(void *arg, const struct golFrame *f);
+void writeBoard(struct golSim *sim, char *filename, int iters);
+void check(struct golSim *sim, int result);
+double now(void);
+struct batchBoard *readManifest(char *filename, int *numBoards);
+void runBoard(const struct golOptions *opts, struct batchBoard *b);
+void *batchWorker(void *args);
+void runBatch(char *manifest, struct golOptions *opts);
 
 void verifyCmdArgs(int argc, char *argv[]) {
   /*
@@ -116,9 +82,22 @@ void verifyCmdArgs(int argc, char *argv[]) {
    * Returns: Nothing
    */
   
-  // Verify caller passed in 6 command arguments
-  if (argc != 6) {
-   printf("usage: ./gol configFile printCondition numTIDs partition[0:1] print_config[0:1]\n");
+  // Verify caller passed in at least 6 command arguments
+  if (argc < 6) {
+   printf("usage: ./gol configFile printCondition numTIDs partition[0:2] print_config[0:1]"
+          " [--engine=auto|char|bit|hashlife|sparse|stream|shard] [--stream=file]"
+          " [--shards=n] [--transport=shm|socket]"
+          " [--simd=auto|avx512|avx2|sse2|scalar]"
+          " [--boundary=torus|dead] [--tile=RxC] [--sched=static|steal] [--hugepages]"
+          " [--active] [--halo-depth=k] [--sync=barrier|neighbor] [--pin]"
+          " [--numa=first-touch|interleave|local] [--iters=n] [--size=RxC] [--output=file]"
+          " [--checkpoint=file] [--checkpoint-every=n] [--restart] [--frames=prefix]"
+          " [--frame-format=pbm|pgm] [--frame-every=n] [--frame-delay=ms] [--profile]"
+          " [--counters] [--trace=file] [--batch] [--cycles=stop|skip] [--rule=Bn/Sn]\n"
+          "configFile holds the board as rows, cols, iterations, number of cells and"
+          " the cells' row col pairs, or an RLE, Life 1.06 or plaintext pattern."
+          " With --batch it lists seed files instead, one per line, each optionally"
+          " followed by its iterations\n");
    exit(1);
   }
 
@@ -135,8 +114,8 @@ void verifyCmdArgs(int argc, char *argv[]) {
   }
 
   // Verify valid partition
-  if (atoi(argv[4]) != 0 && atoi(argv[4]) != 1) {
-    printf("Invalid partition, must be either 0 or 1\n");
+  if (atoi(argv[4]) < 0 || atoi(argv[4]) > 2) {
+    printf("Invalid partition, must be 0 (rows), 1 (columns) or 2 (tiles)\n");
     exit(1);
 
   }
@@ -149,355 +128,710 @@ void verifyCmdArgs(int argc, char *argv[]) {
 
 }
 
-int numNeighbors(int xCoord, int yCoord){
+void parseOptions(int argc, char *argv[], struct golOptions *opts) {
   /*
-   * Purpose: Finds the number of neighbors of a point on the board
-   * Inputs: Coordinates:            xCoord, yCoord
-   *         Rows & Columns:         rows, cols
-   *         Game board:             board
-   *         Number of coordinates:  numCoords
-   * Returns: Number of neighbors of (xCoord, yCoord) neighborCounter
+   * Purpose: Reads the 5 positional arguments and the optional --flags that
+   *          follow them into the simulation's options and the globals
+   * Inputs: Number of command-line arguments: argc
+   *         Array of command-line arguments:  argv
+   *         Options:                          opts
+   *
+   * Returns: Nothing
    */
-  
-  int neighborCounter, i, j, k, x, y;
-  x = xCoord;
-  y = yCoord;
-  neighborCounter = 0;
-  
-  // Locates the current row and determines if it has wrapped
-  for(j = -1; j< 2; j++){
-    int currentRow;
-    currentRow = x+j;
-    if(currentRow == rows){
-      currentRow = 0;  	  
-    }else if(currentRow ==-1){
-      currentRow = rows-1;
-    }
-    
-    // Locates the current column and determines if it has wrapped
-    for(k = -1;k<2;k++){
-      int currentCol;
-      currentCol = y +k;
-      if(currentCol == cols){
-          currentCol = 0;
-      }else if(currentCol == -1){
-        currentCol = cols-1;
-      }  	  
-      
-      // Increments neighborCounter for each neighbor found
-      if(currentRow == x && currentCol == y){
-        continue;
-      }else if(refBoard[currentRow*rows+currentCol] == '@'){
-         neighborCounter++;
-      }
+  static struct option longOptions[] = {
+    {"engine", required_argument, 0, 'e'},
+    {"output", required_argument, 0, 'o'},
+    {"simd", required_argument, 0, 's'},
+    {"hugepages", no_argument, 0, 'H'},
+    {"boundary", required_argument, 0, 'b'},
+    {"tile", required_argument, 0, 't'},
+    {"sched", required_argument, 0, 'S'},
+    {"active", no_argument, 0, 'a'},
+    {"halo-depth", required_argument, 0, 'k'},
+    {"sync", required_argument, 0, 'y'},
+    {"pin", no_argument, 0, 'P'},
+    {"numa", required_argument, 0, 'N'},
+    {"iters", required_argument, 0, 'i'},
+    {"size", required_argument, 0, 'z'},
+    {"checkpoint", required_argument, 0, 'c'},
+    {"checkpoint-every", required_argument, 0, 'C'},
+    {"restart", no_argument, 0, 'R'},
+    {"frames", required_argument, 0, 'f'},
+    {"frame-format", required_argument, 0, 'F'},
+    {"frame-every", required_argument, 0, 'n'},
+    {"frame-delay", required_argument, 0, 'd'},
+    {"profile", no_argument, 0, 'p'},
+    {"counters", no_argument, 0, 'K'},
+    {"trace", required_argument, 0, 'T'},
+    {"batch", no_argument, 0, 'B'},
+    {"cycles", required_argument, 0, 'Y'},
+    {"rule", required_argument, 0, 'r'},
+    {"stream", required_argument, 0, 'm'},
+    {"shards", required_argument, 0, 'j'},
+    {"transport", required_argument, 0, 'x'},
+    {0, 0, 0, 0}
+  };
+  int opt;
+
+  golDefaults(opts);
+  opts->threads = atoi(argv[3]);
+  opts->partition = atoi(argv[4]);
+  optind = 6;
+  while ((opt = getopt_long(argc, argv, "e:o:s:Hb:t:S:ak:y:PN:i:z:c:C:Rf:F:n:d:pKT:BY:r:m:j:x:", longOptions, NULL)) != -1) {
+    switch (opt) {
+      case 'e':
+        if (!strcmp(optarg, "char")) {
+          opts->engine = GOL_ENGINE_CHAR;
+        } else if (!strcmp(optarg, "bit")) {
+          opts->engine = GOL_ENGINE_BIT;
+        } else if (!strcmp(optarg, "hashlife")) {
+          opts->engine = GOL_ENGINE_HASHLIFE;
+        } else if (!strcmp(optarg, "sparse")) {
+          opts->engine = GOL_ENGINE_SPARSE;
+        } else if (!strcmp(optarg, "stream")) {
+          opts->engine = GOL_ENGINE_STREAM;
+        } else if (!strcmp(optarg, "shard")) {
+          opts->engine = GOL_ENGINE_SHARD;
+        } else if (!strcmp(optarg, "auto")) {
+          opts->engine = GOL_ENGINE_AUTO;
+        } else {
+          printf("Invalid engine, must be char, bit, hashlife, sparse, stream, shard or auto\n");
+          exit(1);
+        }
+        break;
+      case 'o':
+        outFile = optarg;
+        break;
+      case 's':
+        opts->simd = optarg;
+        break;
+      case 'H':
+        opts->hugePages = 1;
+        break;
+      case 'b':
+        if (!strcmp(optarg, "torus")) {
+          opts->deadBoundary = 0;
+        } else if (!strcmp(optarg, "dead")) {
+          opts->deadBoundary = 1;
+        } else {
+          printf("Invalid boundary, must be either torus or dead\n");
+          exit(1);
+        }
+        break;
+      case 't':
+        if (sscanf(optarg, "%dx%d", &opts->tileRows, &opts->tileCols) != 2 ||
+            opts->tileRows < 1 || opts->tileCols < 1) {
+          printf("Invalid tile, must be RxC with positive R and C\n");
+          exit(1);
+        }
+        break;
+      case 'S':
+        if (!strcmp(optarg, "static")) {
+          opts->workStealing = 0;
+        } else if (!strcmp(optarg, "steal")) {
+          opts->workStealing = 1;
+        } else {
+          printf("Invalid sched, must be either static or steal\n");
+          exit(1);
+        }
+        break;
+      case 'a':
+        opts->activeTiles = 1;
+        break;
+      case 'k':
+        if ((opts->haloDepth = atoi(optarg)) < 1) {
+          printf("Invalid halo-depth, must be a positive integer\n");
+          exit(1);
+        }
+        break;
+      case 'y':
+        if (!strcmp(optarg, "barrier")) {
+          opts->syncNeighbors = 0;
+        } else if (!strcmp(optarg, "neighbor")) {
+          opts->syncNeighbors = 1;
+        } else {
+          printf("Invalid sync, must be either barrier or neighbor\n");
+          exit(1);
+        }
+        break;
+      case 'P':
+        opts->pinThreads = 1;
+        break;
+      case 'N':
+        if (!strcmp(optarg, "first-touch")) {
+          opts->numaMode = GOL_NUMA_FIRST_TOUCH;
+        } else if (!strcmp(optarg, "interleave")) {
+          opts->numaMode = GOL_NUMA_INTERLEAVE;
+        } else if (!strcmp(optarg, "local")) {
+          opts->numaMode = GOL_NUMA_LOCAL;
+        } else {
+          printf("Invalid numa, must be first-touch, interleave or local\n");
+          exit(1);
+        }
+        break;
+      case 'i':
+        if ((itersOption = atoi(optarg)) < 0) {
+          printf("Invalid iters, must be a non-negative integer\n");
+          exit(1);
+        }
+        break;
+      case 'z':
+        if (sscanf(optarg, "%dx%d", &opts->rows, &opts->cols) != 2 ||
+            opts->rows < 1 || opts->cols < 1) {
+          printf("Invalid size, must be RxC with positive R and C\n");
+          exit(1);
+        }
+        break;
+      case 'c':
+        opts->checkpointFile = optarg;
+        break;
+      case 'C':
+        if ((opts->checkpointEvery = atoi(optarg)) < 1) {
+          printf("Invalid checkpoint-every, must be a positive integer\n");
+          exit(1);
+        }
+        break;
+      case 'R':
+        restartRun = 1;
+        break;
+      case 'f':
+        framePrefix = optarg;
+        break;
+      case 'F':
+        if (!strcmp(optarg, "pbm")) {
+          frameFormat = FRAME_PBM;
+        } else if (!strcmp(optarg, "pgm")) {
+          frameFormat = FRAME_PGM;
+        } else {
+          printf("Invalid frame-format, must be either pbm or pgm\n");
+          exit(1);
+        }
+        break;
+      case 'n':
+        if ((opts->frameEvery = atoi(optarg)) < 1) {
+          printf("Invalid frame-every, must be a positive integer\n");
+          exit(1);
+        }
+        break;
+      case 'd':
+        if ((frameDelay = atoi(optarg)) < 0) {
+          printf("Invalid frame-delay, must be a non-negative number of milliseconds\n");
+          exit(1);
+        }
+        break;
+      case 'p':
+        opts->profiling = 1;
+        break;
+      case 'K':
+        opts->profiling = 1;
+        opts->hwCounters = 1;
+        break;
+      case 'T':
+        opts->profiling = 1;
+        opts->trace = 1;
+        traceFile = optarg;
+        break;
+      case 'B':
+        batchRun = 1;
+        break;
+      case 'Y':
+        if (!strcmp(optarg, "stop")) {
+          opts->cycles = GOL_CYCLES_STOP;
+        } else if (!strcmp(optarg, "skip")) {
+          opts->cycles = GOL_CYCLES_SKIP;
+        } else {
+          printf("Invalid cycles, must be either stop or skip\n");
+          exit(1);
+        }
+        break;
+      case 'r':
+        opts->rule = optarg;
+        break;
+      case 'm':
+        opts->streamFile = optarg;
+        break;
+      case 'j':
+        opts->shards = atoi(optarg);
+        break;
+      case 'x':
+        opts->transport = optarg;
+        break;
+      default:
+        exit(1);
     }
   }
-  return neighborCounter;
+  // Combinations of options are vetted by golCreate. --restart carries on
+  // from the stream file, or the checkpoint, or both in that order
+  if ((opts->checkpointEvery || (restartRun && !opts->streamFile)) && !opts->checkpointFile) {
+    printf("Invalid checkpoint, --checkpoint-every and --restart need --checkpoint=file,"
+           " or --stream=file for --restart\n");
+    exit(1);
+  }
+  opts->streamResume = restartRun && opts->streamFile;
+  frameTerminal = atoi(argv[2]);
+  if (batchRun && (frameTerminal || framePrefix || opts->checkpointFile || traceFile ||
+                   outFile || opts->profiling || opts->streamFile ||
+                   opts->engine == GOL_ENGINE_SHARD)) {
+    printf("Invalid batch, boards in a batch can't be printed, checkpointed, traced,"
+           " profiled, saved, streamed or sharded\n");
+    exit(1);
+  }
+  if (frameTerminal || framePrefix) {
+    opts->frameFn = drawFrame;
+    opts->frameWait = framePrefix != NULL;
+  }
 }
 
-char *copyBoard(char *board, int rows, int cols) {
+void showFrame(const struct golFrame *f) {
   /*
-   * Purpose: Creates a copy of the board
-   * Inputs: Game board:             board
-   *         Rows & Columns:         rows, cols
-   * Returns: Number of neighbors of (xCoord, yCoord) neighborCounter
+   * Purpose: Draws a frame on the terminal in one write, moving the cursor
+   *          home with an ANSI escape rather than clearing the screen
+   * Inputs: Frame: f
+   * Returns: Nothing
    */
-  int i;
-  char *newBoard = (char *)malloc(sizeof(char)*(rows*cols));
-
-  // Verify malloc worked
-  if (newBoard == NULL) {
-    printf("malloc failed");
+  static int cleared = 0;
+  char *p;
+  int x, y;
+  if (!frameText && !(frameText = (char *)malloc((size_t)f->rows*(2*f->cols+1) + 128))) {
+    printf("malloc error\n");
     exit(1);
   }
-  
-  // Copy values of old array into new array
-  for (i = 0; i < rows*cols; i++) {
-    newBoard[i] = board[i];
+  p = frameText;
+  if (!cleared) {
+    p += sprintf(p, "\033[2J");
+    cleared = 1;
   }
-  return newBoard;
+  p += sprintf(p, "\033[H");
+  if (activeTiles && f->skipped >= 0) {
+    p += sprintf(p, "Iteration %ld (%d of %d tiles skipped)\n", f->gen, f->skipped, f->tiles);
+  } else {
+    p += sprintf(p, "Iteration %ld\n", f->gen);
+  }
+  for (x = 0; x < f->rows; x++) {
+    const uint64_t *row = f->cells + (size_t)x*f->words;
+    for (y = 0; y < f->cols; y++) {
+      *p++ = ((row[y/64] >> (y%64)) & 1) ? '@' : '-';
+      *p++ = ' ';
+    }
+    *p++ = '\n';
+  }
+  *p++ = '\n';
+  fwrite(frameText, 1, p-frameText, stdout);
+  fflush(stdout);
 }
 
-
-void *evolve(void *args) {
+void saveFrame(const struct golFrame *f) {
   /*
-   * Purpose: Examines the board and applies the rules of the Game of Life
-   * Inputs: Coordinates:            x, y
-   *         Rows & Columns:         rows, cols
-   *         Game board:             board
-   *         Command-line arguments: argv[]
-   *         Number of coordinates:  numCoords
-   *         Number of iterations:   iters
+   * Purpose: Saves a frame as prefixNNNNNN.pbm or .pgm, live cells black
+   * Inputs: Frame: f
    * Returns: Nothing
-   */ 
-
-  int x, y, z;
-  int start_Row,end_Row,start_Col,end_Col;
-  start_Row = ((struct tid_args *)args)->startRow;
-  end_Row = ((struct tid_args *)args)->endRow;
-  start_Col = ((struct tid_args *)args)->startCol;
-  end_Col = ((struct tid_args *)args)->endCol;
-  
-  // Loop over the specified number of iterations
-  for(z = 0; z < ((struct tid_args *)args)->iter; z++) {
-    for(x = start_Row; x <= end_Row; x++) {
-      for(y = start_Col; y <= end_Col; y++) {
-          int neighbors = numNeighbors(x, y);
-        // printf("Point (%d,%d) has %d neighbors\n",x,y,neighbors);
-        if (neighbors < 0 || neighbors > 8) {
-          printf("Invalid number of neighbors. Should be between 0 and 8");
-          exit(1);
-        }
-        //printf("startcol = %d, endcol = %d\n", start_Col, end_Col);
-        if(neighbors < 2){
-          //printf("x = %d, y = %d\n", x, y);
-          newBoard[x*rows+y]= '-';
-      
-        } else if(neighbors > 3){
-            newBoard[x*rows+y] = '-';
-  
-        } else if(neighbors == 3){
-            newBoard[x*rows+y] = '@';
-      
-        } else {
-            newBoard[x*rows+y] = refBoard[x*rows+y];
-        }
+   */
+  char filename[PATH_MAX];
+  unsigned char *line;
+  size_t lineBytes = (frameFormat == FRAME_PBM) ? (size_t)(f->cols+7)/8 : (size_t)f->cols;
+  FILE *file;
+  int x, y;
+
+  snprintf(filename, sizeof(filename), "%s%06ld.%s", framePrefix, f->gen,
+           (frameFormat == FRAME_PBM) ? "pbm" : "pgm");
+  if (!(file = fopen(filename, "wb"))) {
+    printf("Unable to open frame file %s\n", filename);
+    return;
+  }
+  if (!(line = (unsigned char *)malloc(lineBytes))) {
+    printf("malloc error\n");
+    exit(1);
+  }
+  if (frameFormat == FRAME_PBM) {
+    fprintf(file, "P4\n%d %d\n", f->cols, f->rows);
+  } else {
+    fprintf(file, "P5\n%d %d\n255\n", f->cols, f->rows);
+  }
+  for (x = 0; x < f->rows; x++) {
+    const uint64_t *row = f->cells + (size_t)x*f->words;
+    if (frameFormat == FRAME_PBM) {
+      // PBM packs eight cells a byte like a frame does, but with the first
+      // in the high bit, so each byte is bit-reversed
+      for (y = 0; y < (int)lineBytes; y++) {
+        unsigned char b = (unsigned char)(row[y/8] >> (8*(y%8)));
+        b = (unsigned char)((b & 0xF0) >> 4 | (b & 0x0F) << 4);
+        b = (unsigned char)((b & 0xCC) >> 2 | (b & 0x33) << 2);
+        line[y] = (unsigned char)((b & 0xAA) >> 1 | (b & 0x55) << 1);
+      }
+    } else {
+      for (y = 0; y < f->cols; y++) {
+        line[y] = ((row[y/64] >> (y%64)) & 1) ? 0 : 255;
       }
     }
-  pthread_barrier_wait(&barrier);
-  pthread_barrier_wait(&barrier2);
+    fwrite(line, 1, lineBytes, file);
+  }
+  free(line);
+  if (fclose(file)) {
+    printf("Unable to write frame file %s\n", filename);
   }
 }
 
-void *update(void *args) {
+void drawFrame(void *arg, const struct golFrame *f) {
   /*
-   * Purpose: Updates the game board after other threads have evolved
-   *          
-   * Inputs: Argument struct: *args
+   * Purpose: Frame callback: saves and shows each frame, pausing
+   *          --frame-delay between terminal frames
+   * Inputs: Unused: arg
+   *         Frame:  f
    * Returns: Nothing
    */
-  int thisIter;
-  int printCond = ((struct tid_args *)args)->willPrint;
-  char *temp = NULL;
-  for(thisIter = 0; thisIter < ((struct tid_args *)args)->iter; thisIter++) {
-    pthread_barrier_wait(&barrier);
-    temp = refBoard; 
-    refBoard = copyBoard(newBoard,rows,cols);
-    free(temp);
-    if (printCond) { 
-      printf("Iteration %d\n",thisIter);
-    }
-    print(printCond);
-    if (printCond) {
-    system("clear");
+  (void)arg;
+  if (framePrefix) {
+    saveFrame(f);
+  }
+  if (frameTerminal) {
+    showFrame(f);
+    if (frameDelay) {
+      usleep(frameDelay*1000);
     }
-    pthread_barrier_wait(&barrier2);
   }
 }
 
-FILE *openFile(char *filename[]) {
+void writeBoard(struct golSim *sim, char *filename, int iters) {
   /*
-   * Purpose: Bundles together a few lines for opening the test parameter
-   *          file
-   * Inputs:  Input file: filename
-   * Returns: Opened file: inFile
+   * Purpose: Saves the current board in the config file format so a run's
+   *          result can be diffed or fed back in as a seed
+   * Inputs: Simulation:           sim
+   *         Output file:          filename
+   *         Number of iterations: iters
+   * Returns: Nothing
    */
-  FILE *inFile = fopen(filename[1],"r");
-  if (inFile == NULL) {
-    printf("Unable to load test parameters.\n");
-    printf("Invalid test parameter file, must be a .txt file.\n");
+  FILE *outFile = fopen(filename, "w");
+  struct golInfo info;
+  long i, numCoords;
+  int *coords;
+  if (outFile == NULL) {
+    printf("Unable to open output file %s\n", filename);
+    exit(1);
+  }
+  golInfo(sim, &info);
+  numCoords = golLiveCells(sim, NULL, 0);
+  if (!(coords = (int *)malloc(sizeof(int)*2*(numCoords ? numCoords : 1)))) {
+    printf("malloc error\n");
     exit(1);
   }
-  return inFile;
+  golLiveCells(sim, coords, numCoords);
+  fprintf(outFile, "%d\n%d\n%d\n%ld\n", info.rows, info.cols, iters, numCoords);
+  for (i = 0; i < numCoords; i++) {
+    fprintf(outFile, "%d %d\n", coords[2*i], coords[2*i+1]);
+  }
+  free(coords);
+  fclose(outFile);
 }
 
-
-void partition(struct tid_args *thread_args, int numTids, int partitionType){
+void check(struct golSim *sim, int result) {
   /*
-   * Purpose: Partitions the board either row-wise or column-wise and assigns
-   *          partitions to threads.
-   * Inputs:  Arg struct:     *thread_args
-   *          # of threads:   numtids
-   *          Partition type: partitionType
+   * Purpose: Ends the run with the simulation's message if a call failed
+   * Inputs: Simulation:        sim
+   *         What the call gave: result
    * Returns: Nothing
-   * */
-  int partitions,remainder,i,currentRow;
-  currentRow = 0;
-  partitions = rows/numTids-1;
-  remainder = rows % numTids;
-  if(!partitionType){
-    for(i=0;i<numTids;i++){
-      int startRow,endRow;
-	  startRow = currentRow;
-	  endRow = currentRow+partitions;
-	  if(remainder){
-	    endRow++;
-	    partitions++;
-  	    remainder--;
-  	  }
-  	  thread_args[i].my_tid = i;
-	  thread_args[i].startRow = startRow;
-	  thread_args[i].endRow = endRow;
-	  thread_args[i].startCol = 0;
-	  thread_args[i].endCol = cols-1;
-	  currentRow+=partitions+1;
-	  partitions = rows/numTids-1;
-    }
-  }else{    
-    partitions = cols/numTids-1;
-    int currentCol;
-    currentCol = 0;
-    for(i=0;i<numTids;i++){
-      int startCol,endCol;
-	  startCol = currentCol;
-	  endCol = currentCol+partitions;
-	  if(remainder){
-	    endCol++;
-	    partitions++;
-  	    remainder--;
-  	  }
-  	  thread_args[i].my_tid = i;
-	  thread_args[i].startRow = 0;
-	  thread_args[i].endRow = rows-1;
-	  thread_args[i].startCol = startCol;
-	  thread_args[i].endCol = endCol;
-	  currentCol+=partitions+1;
-	  partitions = rows/numTids-1;
+   */
+  if (result < 0) {
+    printf("%s\n", golError(sim));
+    exit(1);
+  }
+}
 
+double now(void) {
+  /*
+   * Purpose: Reads a monotonic clock
+   * Returns: Seconds since an arbitrary start
+   */
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+struct batchBoard *readManifest(char *filename, int *numBoards) {
+  /*
+   * Purpose: Reads a --batch manifest: a seed file per line, optionally
+   *          followed by its iterations. Blank lines and lines starting
+   *          with # are skipped
+   * Inputs: Manifest file:        filename
+   *         Number of boards, out: numBoards
+   * Returns: The boards, in manifest order
+   */
+  FILE *file = fopen(filename, "r");
+  struct batchBoard *boards = NULL;
+  char *line = NULL, *name, *iters, *rest;
+  size_t lineSize = 0;
+  int count = 0, lineNo = 0;
+  if (file == NULL) {
+    printf("Unable to open manifest %s\n", filename);
+    exit(1);
+  }
+  while (getline(&line, &lineSize, file) != -1) {
+    lineNo++;
+    if (!(name = strtok(line, " \t\r\n")) || name[0] == '#') {
+      continue;
+    }
+    iters = strtok(NULL, " \t\r\n");
+    if (!(boards = (struct batchBoard *)realloc(boards, sizeof(struct batchBoard)*(count+1)))) {
+      printf("malloc error\n");
+      exit(1);
+    }
+    memset(&boards[count], 0, sizeof(struct batchBoard));
+    boards[count].iters = -1;
+    if (iters && ((boards[count].iters = strtol(iters, &rest, 10)) < 0 || *rest ||
+                  strtok(NULL, " \t\r\n"))) {
+      printf("Invalid manifest %s, line %d must be a seed file and optionally its"
+             " iterations\n", filename, lineNo);
+      exit(1);
     }
+    if (!(boards[count].file = strdup(name))) {
+      printf("malloc error\n");
+      exit(1);
+    }
+    count++;
   }
-
+  free(line);
+  fclose(file);
+  if (count == 0) {
+    printf("Invalid manifest %s, it lists no seed files\n", filename);
+    exit(1);
+  }
+  *numBoards = count;
+  return boards;
 }
 
-void printPartitions(struct tid_args *thread_args, int tid, int willPrint){
+void runBoard(const struct golOptions *opts, struct batchBoard *b) {
   /*
-   * Purpose: prints the partitions
-   * Inputs: Arg struct:      *thread_args
-   *         Thread ID:       tid
-   *         Print Condition: willPrint
-   *
+   * Purpose: Runs one board of a batch to the end on the calling thread,
+   *          noting its size, live cells and time, or why it failed
+   * Inputs: Options shared by the batch: opts
+   *         Board:                       b
    * Returns: Nothing
-   * */
-  
-  if(!willPrint){
+   */
+  struct golInfo info;
+  struct golSim *sim;
+  long iters;
+  double start = now();
+
+  sim = golCreate(opts);
+  if (golLoad(sim, b->file) < 0) {
+    b->error = strdup(golError(sim));
+    golDestroy(sim);
+    return;
+  }
+  golInfo(sim, &info);
+  iters = (b->iters >= 0) ? b->iters : (itersOption >= 0) ? itersOption : info.seedIters;
+  if (iters < 0) {
+    b->error = strdup("Invalid iters, this seed file has no header, so the manifest or"
+                      " --iters must give them");
+    golDestroy(sim);
     return;
-  }else{
-      struct tid_args current;
-      current = thread_args[tid];
-      int tid,startRow,endRow,rowPartSize,startCol,endCol,colPartSize;
-      tid = current.my_tid;
-      startRow = current.startRow;
-      endRow = current.endRow;
-      rowPartSize = current.endRow-current.startRow+1;
-      startCol = current.startCol;
-      endCol = current.endCol;
-      colPartSize = current.endCol-current.startCol+1;
-      printf("tid %d: rows: %d:%d (%d) cols: %d:%d (%d)\n",tid,startRow,endRow,rowPartSize,
-        startCol,endCol,colPartSize);
+  }
+  if (golStep(sim, iters) < 0) {
+    b->error = strdup(golError(sim));
+    golDestroy(sim);
+    return;
+  }
+  b->live = golLiveCells(sim, NULL, 0);
+  golInfo(sim, &info);
+  golDestroy(sim);
+  b->rows = info.rows;
+  b->cols = info.cols;
+  b->steps = info.generation;
+  b->seconds = now() - start;
+}
+
+void *batchWorker(void *args) {
+  /*
+   * Purpose: Body of a batch thread: claims boards until none are left
+   * Inputs: The batch: *args
+   * Returns: Nothing
+   */
+  struct batch *batch = (struct batch *)args;
+  int i;
+  while ((i = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED)) < batch->numBoards) {
+    runBoard(batch->opts, &batch->boards[i]);
+  }
+  return NULL;
+}
+
+void runBatch(char *manifest, struct golOptions *opts) {
+  /*
+   * Purpose: Runs every board of a manifest, opts->threads at a time with a
+   *          thread apiece, then reports each board in manifest order and
+   *          the throughput of the whole batch. A board that fails is
+   *          reported and the rest carry on
+   * Inputs: Manifest file: manifest
+   *         Options:       opts
+   * Returns: Nothing
+   */
+  struct golOptions boardOpts = *opts;
+  struct batch batch;
+  struct batchBoard *b;
+  pthread_t *tids;
+  double start, wall, busy = 0, updates = 0;
+  int i, numTids, failed = 0;
+
+  if (opts->threads < 1) {
+    printf("Invalid numTIDs, a batch needs at least one thread\n");
+    exit(1);
+  }
+  batch.boards = readManifest(manifest, &batch.numBoards);
+  batch.next = 0;
+  batch.opts = &boardOpts;
+  boardOpts.threads = 1;
+  numTids = opts->threads < batch.numBoards ? opts->threads : batch.numBoards;
+  if (!(tids = (pthread_t *)malloc(sizeof(pthread_t)*numTids))) {
+    printf("malloc error\n");
+    exit(1);
+  }
+  start = now();
+  for (i = 0; i < numTids; i++) {
+    if (pthread_create(&tids[i], NULL, batchWorker, &batch)) {
+      perror("Error pthread_create\n");
+      exit(1);
     }
-  
+  }
+  for (i = 0; i < numTids; i++) {
+    pthread_join(tids[i], NULL);
+  }
+  wall = now() - start;
+
+  for (i = 0; i < batch.numBoards; i++) {
+    b = &batch.boards[i];
+    if (b->error) {
+      printf("Board %d %s: %s\n", i, b->file, b->error);
+      failed++;
+    } else {
+      printf("Board %d %s: %ld steps of a %d x %d board, %ld live cells, %f seconds\n",
+             i, b->file, b->steps, b->rows, b->cols, b->live, b->seconds);
+      updates += (double)b->rows*b->cols*b->steps;
+      busy += b->seconds;
+    }
+    free(b->file);
+    free(b->error);
+  }
+  printf("Batch of %d boards (%d failed) on %d threads: %.0f cell updates in %f seconds,"
+         " %.0f cells/second, threads busy %.1f%%\n", batch.numBoards, failed, numTids,
+         updates, wall, wall > 0 ? updates/wall : 0.0,
+         wall > 0 ? 100.0*busy/(wall*numTids) : 0.0);
+  free(batch.boards);
+  free(tids);
+  if (failed) {
+    exit(1);
+  }
 }
 
 int main(int argc, char *argv[]) {
-  system("clear");
-  
   // Variable declarations
-  int count = 1;
-  int iters,numCoords,numThreads,printPartition,partitionType,print_alloc;
+  struct golOptions opts;
+  struct golInfo info;
+  struct golSim *sim;
+  int iters,steps,print_alloc,restored;
+  long startGen;
   struct timeval start, end;
-  newBoard = NULL;
-  refBoard = NULL;
-  char *temp;
-  pthread_t *tids;
+  double loadStart, loadTime;
   verifyCmdArgs(argc, argv);
-  FILE *inFile = openFile(argv);
-  numThreads = atoi(argv[3]);
-  partitionType = atoi(argv[4]);
-  printPartition = atoi(argv[2]);
+  parseOptions(argc, argv, &opts);
+
+  // A batch has nothing to draw, so leaves the screen alone
+  if (batchRun) {
+    runBatch(argv[1], &opts);
+    return 0;
+  }
+  system("clear");
   print_alloc = atoi(argv[5]);
- 
-  // allocate space for array of pthreads
-  if(!(tids = (pthread_t *)malloc(sizeof(pthread_t)*(numThreads+1)))){
-    printf("malloc error\n");
+  activeTiles = opts.activeTiles;
+  // The load balance report below needs each worker's tiles timed
+  opts.loadBalance = opts.workStealing || print_alloc;
+
+  // Read the seed file into a new simulation, whose workers are started
+  // first so they can share the reading of a big one
+  sim = golCreate(&opts);
+  loadStart = now();
+  check(sim, golLoad(sim, argv[1]));
+  golInfo(sim, &info);
+  iters = (itersOption >= 0) ? itersOption : info.seedIters;
+  if (iters < 0) {
+    printf("Invalid iters, this seed file has no header, so --iters is needed\n");
     exit(1);
   }
-  // allocate space for array of pthread args
-  if(!(thread_args = (struct tid_args *)malloc(sizeof(struct tid_args)*(1+numThreads)))){
-    printf("malloc error\n");
-    exit(1);
+  if (restartRun && opts.engine == GOL_ENGINE_STREAM) {
+    if (!info.resumed) {
+      printf("No stream file %s, starting from the seed\n", opts.streamFile);
+    } else if (info.generation > iters) {
+      printf("Invalid stream file %s, generation %ld is past the %d iterations asked for\n",
+             opts.streamFile, info.generation, iters);
+      exit(1);
+    } else {
+      printf("Restarted from %s at generation %ld\n", opts.streamFile, info.generation);
+    }
   }
-  // Initialize barriers
-  if(pthread_barrier_init(&barrier,0,numThreads+1)){
-    perror("Pthread barrier init error\n");
-    exit(1);
-  }   
-  if(pthread_barrier_init(&barrier2,0,numThreads+1)){
-    perror("Pthread barrier2 init error\n");
-    exit(1);
+  if (restartRun && opts.checkpointFile) {
+    check(sim, restored = golRestore(sim, opts.checkpointFile));
+    golInfo(sim, &info);
+    if (!restored) {
+      printf("No checkpoint %s, starting from %s\n", opts.checkpointFile,
+             info.resumed ? "the stream file" : "the seed");
+    } else if (info.generation > iters) {
+      printf("Invalid checkpoint %s, generation %ld is past the %d iterations asked for\n",
+             opts.checkpointFile, info.generation, iters);
+      exit(1);
+    } else {
+      printf("Restarted from %s at generation %ld\n", opts.checkpointFile, info.generation);
+    }
+  }
+  loadTime = now() - loadStart;
+  startGen = info.generation;
+  steps = iters - startGen;
+  if (print_alloc) {
+    golReport(sim, GOL_REPORT_PARTITIONS | GOL_REPORT_KERNEL);
   }
-  
-  // Open test parameter file and read in first 4 lines
-  fscanf(inFile, "%d %d %d %d", &rows, &cols, &iters, &numCoords);
-
-  // Create game board initialized to starting state
-  newBoard = makeBoard(rows,cols,inFile,numCoords);
-  refBoard = copyBoard(newBoard,rows,cols);
   
   // Apply the life and death conditions to the board
   gettimeofday(&start, NULL);
- 
-  /*
-   *  Spawn worker threads
-   *  each thread does a round, taking a specified a part of the board
-   *    refBoard still passed into evolve, but we're going to be looking at
-   *    different portions of it. 
-   *
-   *    
-   */
-  partition(thread_args,numThreads,partitionType);
-
-  int i, ret;
-
-  // spawn threads
-  for(i = 0; i<numThreads; i++) {
-     
-     thread_args[i].willPrint = printPartition;
-     thread_args[i].iter = iters;
-     ret = pthread_create(&tids[i],0,evolve,(void *)&thread_args[i]);
-     if(ret){
-       perror("Error pthread_create\n");
-     }
-  }
-     i = numThreads;
-     thread_args[i].willPrint = printPartition;
-     thread_args[i].iter = iters;
-     thread_args[i].my_tid = i;
-     ret = pthread_create(&tids[i],0,update,(void *)&thread_args[i]);
-     if(ret){
-       perror("Error pthread_create\n");
-     }
-  for(i=0; i<numThreads+1;i++) {
-     pthread_join(tids[i],0);
-  }
-  
+  check(sim, golStep(sim, steps));
   gettimeofday(&end, NULL);
+  // A cycle may have ended the run early
+  golInfo(sim, &info);
+  steps = info.generation - startGen;
+  if (print_alloc) {
+    golReport(sim, GOL_REPORT_HASHLIFE | GOL_REPORT_SPARSE);
+  }
+  if (opts.frameFn) {
+    golPushFrame(sim);
+    if (golFlush(sim) < 0) {
+      printf("%s\n", golError(sim));
+    }
+  }
   
   // Time calculations
   long elapsed = (end.tv_sec-start.tv_sec)*1000000 + (end.tv_usec - 
                   start.tv_usec);
+  printf("Load time for %ld cells: %f seconds\n", info.seedCells, loadTime);
   printf("Elapsed time for %d steps of a %d x %d board is: %f seconds\n",
-                  iters, rows, cols, elapsed/1000000.);
+                  steps, info.rows, info.cols, elapsed/1000000.);
+  golReport(sim, ((opts.workStealing || print_alloc) ? GOL_REPORT_BALANCE : 0) |
+                 (print_alloc ? GOL_REPORT_PLACEMENT : 0) | GOL_REPORT_PROFILE);
+  if (traceFile) {
+    check(sim, golWriteTrace(sim, traceFile));
+  }
+  golReport(sim, GOL_REPORT_SKIPPED | GOL_REPORT_CYCLE);
+  if (opts.checkpointFile) {
+    if (golFlush(sim) < 0) {
+      printf("%s\n", golError(sim));
+    }
+    if (golSave(sim, opts.checkpointFile) < 0) {
+      printf("%s\n", golError(sim));
+    }
+  }
+  golReport(sim, GOL_REPORT_OUTPUT);
+
+  if (outFile) {
+    writeBoard(sim, outFile, iters);
+  }
 
   // Free space
-  free(tids);
-  free(thread_args);
-  free(newBoard);
-  free(refBoard);
-  fclose(inFile);
-  refBoard = NULL;
-  newBoard = NULL;
-  temp = NULL;
+  golDestroy(sim);
+  free(frameText);
 
   return 0;
 }
-